@@ -0,0 +1,92 @@
+// Batched inference throughput benchmark.
+// Runs the detector network on batches of 1 to 8 frames with one forward pass each
+// and reports the time per batch and the frames per second against single frame calls.
+// First checks that a batch of two decodes to the same boxes as two single frame passes.
+// Usage: batch-bench [cfg] [weights] [iterations] [input size]
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "../src/batchscheduler.hpp"
+#include "../src/utils.hpp"
+
+using namespace std;
+
+bool checkBatch (BatchScheduler &scheduler) {
+    /**
+     * A batch of two must decode to the same boxes as each frame on its own. The
+     * threshold is dropped for the check so random frames give plenty of boxes.
+    */
+
+    std::vector<cv::Mat> frames(2);
+    for (auto &frame : frames) {
+        frame = cv::Mat(cv::Size(800, 448), CV_8UC3);
+        cv::randu(frame, 0, 255);
+    }
+    scheduler.getDecoder().setThresholds(0.01f, 0.0f);
+
+    std::vector<Detections> batched, single;
+    scheduler.detect(frames, batched);
+    bool ok = batched.size() == 2;
+    size_t boxes = 0;
+    for (size_t i=0; i<frames.size() && ok; i++) {
+        scheduler.detect({frames[i]}, single);
+        ok = batched[i].size() == single[0].size();
+        for (size_t b=0; b<single[0].size() && ok; b++) {
+            cv::Rect difference = batched[i].boxes[b] - single[0].boxes[b].tl();
+            ok = batched[i].class_ids[b] == single[0].class_ids[b] && std::abs(difference.x) <= 1 
+                && std::abs(difference.y) <= 1 && std::abs(batched[i].confidences[b] - single[0].confidences[b]) < 1e-3f;
+        }
+        boxes += single[0].size();
+    }
+
+    scheduler.getDecoder().setThresholds(0.5f, 0.0f);
+    cout << "batch of 2 against single frames, " << boxes << " boxes: " << (ok ? "ok" : "FAILED") << endl;
+    return ok;
+}
+
+int main (int argc, char** argv) {
+
+    string config = argc > 1 ? argv[1] : "dnn_model/yolov4-tiny.cfg";
+    string weights = argc > 2 ? argv[2] : "dnn_model/yolov4-tiny.weights";
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    int input = argc > 4 ? atoi(argv[4]) : 320;
+
+    cv::dnn::Net net = cv::dnn::readNetFromDarknet(config, weights);
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    BatchScheduler scheduler(net, cv::Size(input, input));
+
+    if (!checkBatch(scheduler)) {
+        return 1;
+    }
+
+    cout << "threads: " << cv::getNumThreads() << ", input: " << input << "x" << input << endl;
+
+    double single_fps = 0.0;
+    for (size_t batch=1; batch<=8; batch++) {
+        std::vector<cv::Mat> frames(batch);
+        for (auto &frame : frames) {
+            frame = cv::Mat(cv::Size(800, 448), CV_8UC3);
+            cv::randu(frame, 0, 255);
+        }
+        std::vector<Detections> detections;
+
+        // The first pass allocates the layers for this batch size
+        scheduler.detect(frames, detections);
+
+        utils::Timer timer;
+        for (int i=0; i<iterations; i++) {
+            scheduler.detect(frames, detections);
+        }
+        double seconds = timer.seconds();
+        double fps = batch * iterations / seconds;
+        if (batch == 1) {
+            single_fps = fps;
+        }
+
+        cout << "batch " << batch << ": " << seconds * 1000 / iterations << " ms/batch, "
+             << fps << " frames/s, " << fps / single_fps << "x single" << endl;
+    }
+    return 0;
+}
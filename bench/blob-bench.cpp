@@ -0,0 +1,63 @@
+// Detector input preprocessing benchmark.
+// Checks the fused BlobKernel against cv::dnn::blobFromImage for several frame and
+// input sizes, then times both. Exits non zero if any output differs by more than
+// one gray level, the most the 8 bit resize in blobFromImage can round away.
+// Usage: blob-bench [iterations]
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "../src/blobkernel.hpp"
+#include "../src/utils.hpp"
+
+using namespace std;
+
+bool runBenchmark (cv::Size frameSize, cv::Size inputSize, bool swapRB, int iterations) {
+
+    cv::Mat frame = cv::Mat(frameSize, CV_8UC3);
+    cv::randu(frame, 0, 255);
+
+    // Smooth the noise a little so the resize sees something like image content
+    cv::GaussianBlur(frame, frame, cv::Size(5, 5), 0);
+
+    BlobKernel kernel;
+    cv::Mat expected, actual;
+    cv::dnn::blobFromImage(frame, expected, 1.0/255, inputSize, cv::Scalar(), swapRB, false);
+    kernel.run(frame, actual, inputSize, 1.0/255, swapRB);
+
+    bool same_shape = expected.size == actual.size;
+    double difference = same_shape ? cv::norm(expected.reshape(1, 1), actual.reshape(1, 1), cv::NORM_INF) * 255 : -1;
+    bool passed = same_shape && difference <= 1.0;
+
+    utils::Timer timer;
+    for (int i=0; i<iterations; i++) {
+        cv::dnn::blobFromImage(frame, expected, 1.0/255, inputSize, cv::Scalar(), swapRB, false);
+    }
+    double reference_ms = timer.seconds() * 1000 / iterations;
+
+    timer.start();
+    for (int i=0; i<iterations; i++) {
+        kernel.run(frame, actual, inputSize, 1.0/255, swapRB);
+    }
+    double fused_ms = timer.seconds() * 1000 / iterations;
+
+    cout << frameSize.width << "x" << frameSize.height << " -> " << inputSize.width << "x" << inputSize.height
+         << (swapRB ? " swapRB" : "") << ": max difference " << difference << " gray levels "
+         << (passed ? "(ok)" : "(FAILED)") << ", blobFromImage " << reference_ms << "ms, fused "
+         << fused_ms << "ms, " << reference_ms / fused_ms << "x" << endl;
+    return passed;
+}
+
+int main (int argc, char** argv) {
+
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+
+    bool passed = true;
+    for (bool swapRB : {false, true}) {
+        passed &= runBenchmark(cv::Size(800, 448), cv::Size(320, 320), swapRB, iterations);
+        passed &= runBenchmark(cv::Size(1600, 896), cv::Size(320, 320), swapRB, iterations);
+        passed &= runBenchmark(cv::Size(320, 320), cv::Size(320, 320), swapRB, iterations);
+        passed &= runBenchmark(cv::Size(150, 100), cv::Size(160, 160), swapRB, iterations);
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// Frame bus throughput benchmark.
+// Publishes frames from one thread and reads them from another through shared 
+// memory, once copying each frame out and once peeking at it in place.
+// Usage: framebus-bench [frames] [width] [height]
+
+#include <iostream>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+#include "../src/framebus.hpp"
+#include "../src/utils.hpp"
+
+using namespace std;
+
+void runBenchmark (bool peek, int frames, cv::Size size) {
+
+    FrameBusWriter writer;
+    writer.create("/frame-bus-bench", 4);
+
+    cv::Mat frame = cv::Mat(size, CV_8UC3);
+    cv::randu(frame, 0, 255);
+    FrameMetadata metadata;
+    metadata.grab_time = std::chrono::steady_clock::now();
+
+    // The reader can only attach once the ring exists
+    writer.publish(frame, metadata);
+    
+    FrameBusReader reader;
+    reader.open("/frame-bus-bench");
+    
+    std::atomic<bool> done = false;
+    std::jthread reader_thread([&] () {
+        cv::Mat received;
+        FrameMetadata received_metadata;
+        uint64_t token;
+        volatile unsigned char sink = 0;
+        while (!done) {
+            if (peek) {
+                if (reader.peek(received, received_metadata, token, 0.1)) {
+                    sink = sink + received.data[received.total() * received.elemSize() - 1];
+                    reader.isCurrent(token);
+                }
+            }
+            else {
+                reader.read(received, received_metadata, 0.1);
+            }
+        }
+    });
+
+    utils::Timer timer;
+    for (int i=0; i<frames; i++) {
+        metadata.sequence = i + 1;
+        metadata.grab_time = std::chrono::steady_clock::now();
+        writer.publish(frame, metadata);
+    }
+    double seconds = timer.seconds();
+    
+    // Give the reader a moment to catch the last frame
+    utils::sleepMilliseconds(50);
+    done = true;
+    reader_thread.join();
+
+    double megabytes = (double)frames * frame.total() * frame.elemSize() / (1024 * 1024);
+    cout << (peek ? "peek" : "read") << ": published " << frames / seconds << " frames/s (" 
+         << megabytes / seconds << " MB/s), reader received " << reader.getReceived() 
+         << ", missed " << reader.getMissed() << ", torn " << reader.getTorn() << ", mid-write retries " << reader.getRetries() << endl;
+}
+
+int main (int argc, char** argv) {
+
+    int frames = argc > 1 ? atoi(argv[1]) : 2000;
+    int width = argc > 2 ? atoi(argv[2]) : 1600;
+    int height = argc > 3 ? atoi(argv[3]) : 896;
+
+    runBenchmark(false, frames, cv::Size(width, height));
+    runBenchmark(true, frames, cv::Size(width, height));
+    return 0;
+}
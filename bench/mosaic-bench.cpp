@@ -0,0 +1,115 @@
+// ROI mosaic benchmark.
+// First checks the packer's mapping with a detector that reports one box filling each
+// placement and one spanning a seam: every region must get back a box covering itself
+// and the spanning box must be discarded. Then, for 1 to 6 regions, times detecting on
+// each region with its own call against packing them into one canvas.
+// Usage: mosaic-bench [cfg] [weights] [iterations] [region input size] [canvas input size]
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "../src/mosaicpacker.hpp"
+#include "../src/utils.hpp"
+#include "../src/yolodecoder.hpp"
+
+using namespace std;
+
+// Reports a box for each of the packer's placements, and one across the first seam
+class PlacementDetector: public Detector {
+    public:
+        PlacementDetector (MosaicPacker *&mosaicPacker) : packer(mosaicPacker) {}
+        void detect (const cv::Mat &, Detections &detections) {
+            detections.clear();
+            auto placements = packer->getPlacements();
+            for (auto &placement : placements) {
+                detections.add(0, 1.0f, placement);
+            }
+            if (placements.size() > 1) {
+                detections.add(0, 1.0f, placements[0] | placements[1]);
+            }
+        }
+        cv::Size getInputSize () {
+            return cv::Size(416, 416);
+        }
+
+    protected:
+        MosaicPacker *&packer;
+};
+
+bool checkMapping () {
+
+    MosaicPacker *packer = nullptr;
+    PlacementDetector placement_detector(packer);
+    MosaicPacker checked(placement_detector);
+    packer = &checked;
+
+    std::vector<cv::Mat> regions = {cv::Mat(cv::Size(300, 200), CV_8UC3), cv::Mat(cv::Size(224, 224), CV_8UC3),
+        cv::Mat(cv::Size(160, 240), CV_8UC3), cv::Mat(cv::Size(200, 120), CV_8UC3)};
+    std::vector<Detections> results;
+    checked.detect(regions, results);
+
+    bool ok = checked.getStats().seam_discarded == 1;
+    for (size_t i=0; i<regions.size(); i++) {
+        cv::Rect whole (cv::Point(), regions[i].size());
+        if (results[i].size() != 1 || (results[i].boxes[0] & whole).area() < 0.95 * whole.area()) {
+            ok = false;
+        }
+    }
+    cout << "mapping check at scale " << checked.getScale() << ": " << (ok ? "ok" : "FAILED") << endl;
+    return ok;
+}
+
+int main (int argc, char** argv) {
+
+    string config = argc > 1 ? argv[1] : "dnn_model/yolov4-tiny.cfg";
+    string weights = argc > 2 ? argv[2] : "dnn_model/yolov4-tiny.weights";
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    int region_input = argc > 4 ? atoi(argv[4]) : 160;
+    int canvas_input = argc > 5 ? atoi(argv[5]) : 416;
+
+    if (!checkMapping()) {
+        return 1;
+    }
+
+    YoloDetector region_detector(cv::dnn::readNetFromDarknet(config, weights), cv::Size(region_input, region_input));
+    YoloDetector canvas_detector(cv::dnn::readNetFromDarknet(config, weights), cv::Size(canvas_input, canvas_input));
+    MosaicPacker packer(canvas_detector);
+
+    cv::Mat frame = cv::Mat(cv::Size(800, 448), CV_8UC3);
+    cv::randu(frame, 0, 255);
+    std::vector<cv::Rect> rois = {cv::Rect(0, 0, 160, 160), cv::Rect(200, 40, 160, 160), cv::Rect(400, 0, 160, 160),
+        cv::Rect(600, 200, 160, 160), cv::Rect(40, 260, 160, 160), cv::Rect(300, 280, 160, 160)};
+
+    cout << "threads: " << cv::getNumThreads() << ", regions at " << region_input << ", canvas at " << canvas_input << endl;
+    for (size_t count=1; count<=rois.size(); count++) {
+        std::vector<cv::Mat> regions;
+        for (size_t i=0; i<count; i++) {
+            regions.push_back(frame(rois[i]));
+        }
+        Detections detections;
+        std::vector<Detections> results;
+
+        // The first pass allocates the layers
+        region_detector.detect(regions[0], detections);
+        packer.detect(regions, results);
+
+        utils::Timer timer;
+        for (int i=0; i<iterations; i++) {
+            for (auto &region : regions) {
+                region_detector.detect(region, detections);
+            }
+        }
+        double per_region_ms = timer.seconds() * 1000 / iterations;
+
+        timer.start();
+        for (int i=0; i<iterations; i++) {
+            packer.detect(regions, results);
+        }
+        double mosaic_ms = timer.seconds() * 1000 / iterations;
+
+        cout << count << " regions: per region calls " << per_region_ms << "ms, mosaic " << mosaic_ms
+             << "ms at scale " << packer.getScale() << ", " << per_region_ms / mosaic_ms << "x" << endl;
+    }
+    cout << packer.printStats() << endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Model startup benchmark.
+// Compares loading the detector the old way, one network read from the Darknet files
+// with layer setup paid on the first frame, with what main now builds through ModelCache:
+// a network per governed input size, the cascade's second stage, the ROI window detector
+// and any tile workers, each parsed from the mapped files and warmed up before the first
+// frame. The cached set runs first, so the page cache, if anything, favours the old way.
+// Pass "before" or "after" to time one case alone, e.g. one per fresh process.
+// Usage: startup-bench [cfg] [weights] [input size] [tile workers] [before|after|both]
+
+#include <algorithm>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "../src/modelcache.hpp"
+#include "../src/utils.hpp"
+
+using namespace std;
+
+double firstForward (cv::dnn::Net &net, const cv::Mat &frame, cv::Size size) {
+
+    utils::Timer timer;
+    net.setInput(cv::dnn::blobFromImage(frame, 1.0/255, size));
+    std::vector<cv::Mat> outs;
+    net.forward(outs, net.getUnconnectedOutLayersNames());
+    return timer.seconds() * 1000;
+}
+
+// The input sizes main creates networks for, in the order it creates them
+std::vector<cv::Size> mainNetworkSizes (cv::Size inputSize, int tileWorkers) {
+
+    std::vector<cv::Size> sizes = {cv::Size(256, 256), cv::Size(320, 320), cv::Size(416, 416)};
+    if (std::find(sizes.begin(), sizes.end(), inputSize) == sizes.end()) {
+        sizes.push_back(inputSize);
+    }
+    sizes.push_back(cv::Size(512, 512));
+    for (int i=0; i<tileWorkers; i++) {
+        sizes.push_back(inputSize);
+    }
+    int window_input = (inputSize.width / 2 + 31) / 32 * 32;
+    sizes.push_back(cv::Size(window_input, window_input));
+    return sizes;
+}
+
+double runAfter (const string &config, const string &weights, const std::vector<cv::Size> &sizes,
+    cv::Size inputSize, const cv::Mat &frame) {
+
+    utils::Timer timer;
+    ModelCache model(config, weights);
+    std::vector<cv::dnn::Net> nets;
+    for (auto &size : sizes) {
+        utils::Timer net_timer;
+        nets.push_back(model.create(cv::dnn::DNN_BACKEND_OPENCV, cv::dnn::DNN_TARGET_CPU, size));
+        cout << "  " << size.width << "x" << size.height << ": " << net_timer.seconds() * 1000 << "ms" << endl;
+    }
+    double startup_ms = timer.seconds() * 1000;
+    size_t start = std::find(sizes.begin(), sizes.end(), inputSize) - sizes.begin();
+    double first_ms = firstForward(nets[start], frame, inputSize);
+    cout << "after: " << model.printStats() << ", total " << startup_ms << "ms, first frame " << first_ms
+         << "ms, ready to first result " << startup_ms + first_ms << "ms" << endl;
+    return startup_ms + first_ms;
+}
+
+double runBefore (const string &config, const string &weights, cv::Size inputSize, const cv::Mat &frame) {
+
+    utils::Timer timer;
+    cv::dnn::Net net = cv::dnn::readNetFromDarknet(config, weights);
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    double read_ms = timer.seconds() * 1000;
+    double first_ms = firstForward(net, frame, inputSize);
+    double second_ms = firstForward(net, frame, inputSize);
+    cout << "before: 1 net, read " << read_ms << "ms, first frame " << first_ms << "ms, steady frame "
+         << second_ms << "ms, ready to first result " << read_ms + first_ms << "ms" << endl;
+    return read_ms + first_ms;
+}
+
+int main (int argc, char** argv) {
+
+    string config = argc > 1 ? argv[1] : "dnn_model/yolov4-tiny.cfg";
+    string weights = argc > 2 ? argv[2] : "dnn_model/yolov4-tiny.weights";
+    int input = argc > 3 ? atoi(argv[3]) : 320;
+    int tile_workers = argc > 4 ? atoi(argv[4]) : 0;
+    string mode = argc > 5 ? argv[5] : "both";
+    cv::Size size = cv::Size(input, input);
+
+    cv::Mat frame = cv::Mat(cv::Size(800, 448), CV_8UC3);
+    cv::randu(frame, 0, 255);
+
+    std::vector<cv::Size> sizes = mainNetworkSizes(size, tile_workers);
+    double after_ms = 0.0, before_ms = 0.0;
+    if (mode != "before") {
+        cout << "after, " << sizes.size() << " networks:" << endl;
+        after_ms = runAfter(config, weights, sizes, size, frame);
+    }
+    if (mode != "after") {
+        before_ms = runBefore(config, weights, size, frame);
+    }
+    if (mode == "both") {
+        cout << "startup change: " << after_ms - before_ms << "ms" << endl;
+    }
+    return 0;
+}
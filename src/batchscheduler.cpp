@@ -0,0 +1,257 @@
+#include "batchscheduler.hpp"
+
+
+BatchScheduler::BatchScheduler (cv::dnn::Net network, cv::Size inputSize, size_t maxBatch, double maxWaitMs)
+    : net(network) {
+
+    /**
+     * @param network - a loaded Darknet YOLO network, with its backend and target set
+     * @param inputSize - network input size
+     * @param maxBatch - largest number of frames run in one forward pass
+     * @param maxWaitMs - longest a frame waits for the batch to fill
+    */
+
+    input_size = inputSize;
+    max_batch = std::max(maxBatch, (size_t)1);
+    max_wait = std::chrono::microseconds((int64_t)(maxWaitMs * 1000));
+    out_names = net.getUnconnectedOutLayersNames();
+    running = false;
+}
+
+// --------------------------------------------------------------------------------------
+
+BatchScheduler::~BatchScheduler () {
+
+    stop();
+}
+
+// --------------------------------------------------------------------------------------
+
+void BatchScheduler::start () {
+
+    if (thread.joinable()) {
+        return;
+    }
+    thread = std::jthread([this] (std::stop_token token) { run(token); });
+    const std::lock_guard<std::mutex> lock (pending_mutex);
+    running = true;
+}
+
+// --------------------------------------------------------------------------------------
+
+void BatchScheduler::stop () {
+    /**
+     * Stop the scheduler thread. Frames still waiting get empty detections, and
+     * later submits are refused until it's started again.
+    */
+
+    {
+        const std::lock_guard<std::mutex> lock (pending_mutex);
+        running = false;
+    }
+    if (thread.joinable()) {
+        thread.request_stop();
+        thread.join();
+    }
+
+    const std::lock_guard<std::mutex> lock (pending_mutex);
+    for (auto &request : pending) {
+        request.result.set_value(Detections());
+    }
+    pending.clear();
+}
+
+// --------------------------------------------------------------------------------------
+
+std::future<Detections> BatchScheduler::submit (const cv::Mat &frame) {
+    /**
+     * Queue a frame for the next batch
+     * @param frame - BGR frame of any size. It must not be written to until the result is ready.
+     * @returns the detections in frame coordinates, once its batch has run
+     * @throws if the scheduler isn't running, since nothing would run the batch
+    */
+
+    Request request;
+    request.frame = frame;
+    request.submitted = std::chrono::steady_clock::now();
+    std::future<Detections> result = request.result.get_future();
+    {
+        const std::lock_guard<std::mutex> lock (pending_mutex);
+        if (!running) {
+            throw std::runtime_error("Frame submitted to a batch scheduler that isn't running");
+        }
+        pending.push_back(std::move(request));
+    }
+    pending_cond.notify_one();
+    return result;
+}
+
+// --------------------------------------------------------------------------------------
+
+void BatchScheduler::detect (const std::vector<cv::Mat> &frames, std::vector<Detections> &detections) {
+    /**
+     * Run a batch of frames with one forward pass. This is what the scheduler thread
+     * runs, so only call it directly when the scheduler isn't started.
+     * @param frames - BGR frames, resized to the input size in the blob
+     * @param detections - receives one result per frame, in that frame's coordinates
+    */
+
+    // Same input parameters DnnDetector gives DetectionModel
+    if (std::all_of(frames.begin(), frames.end(), BlobKernel::supports)) {
+        blob_kernel.runBatch(frames, blob, input_size, 1.0/255, false);
+    }
+    else {
+        cv::dnn::blobFromImages(frames, blob, 1.0/255, input_size, cv::Scalar(), false, false);
+    }
+    net.setInput(blob);
+    net.forward(outs, out_names);
+
+    detections.resize(frames.size());
+    for (size_t i=0; i<frames.size(); i++) {
+        decoder.decode(outs, frames[i].size(), detections[i], i, frames.size());
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size BatchScheduler::getInputSize () {
+
+    return input_size;
+}
+
+// --------------------------------------------------------------------------------------
+
+YoloDecoder& BatchScheduler::getDecoder () {
+
+    return decoder;
+}
+
+// --------------------------------------------------------------------------------------
+
+BatchStats BatchScheduler::getStats () {
+
+    const std::lock_guard<std::mutex> lock (stats_mutex);
+    BatchStats s = stats;
+    s.mean_batch = batch_size.mean();
+    s.mean_forward_ms = forward_ms.mean();
+    s.mean_wait_ms = wait_ms.mean();
+    return s;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string BatchScheduler::printStats () {
+
+    BatchStats s = getStats();
+    std::ostringstream oss;
+    oss << "batches: " << s.batches << ", frames: " << s.frames << ", mean batch: " << s.mean_batch
+        << ", deadline flushes: " << s.deadline_flushes << ", forward: " << s.mean_forward_ms
+        << "ms, wait: " << s.mean_wait_ms << "ms";
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+void BatchScheduler::run (std::stop_token token) {
+    /**
+     * Wait for a full batch or the oldest frame's deadline, then run whatever is waiting
+    */
+
+    std::vector<Request> batch;
+    std::vector<cv::Mat> frames;
+    std::vector<Detections> detections;
+
+    while (!token.stop_requested()) {
+        bool deadline = false;
+        {
+            std::unique_lock<std::mutex> lock (pending_mutex);
+            if (!pending_cond.wait(lock, token, [this] { return !pending.empty(); })) {
+                break;
+            }
+
+            auto flush_time = pending.front().submitted + max_wait;
+            pending_cond.wait_until(lock, token, flush_time, [this] { return pending.size() >= max_batch; });
+            if (token.stop_requested()) {
+                break;
+            }
+            deadline = pending.size() < max_batch;
+
+            size_t count = std::min(pending.size(), max_batch);
+            for (size_t i=0; i<count; i++) {
+                batch.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        frames.clear();
+        for (auto &request : batch) {
+            frames.push_back(request.frame);
+        }
+
+        std::exception_ptr error;
+        try {
+            detect(frames, detections);
+        }
+        catch (const std::exception &e) {
+            spdlog::error("Batch of " + std::to_string(batch.size()) + " failed: " + e.what());
+            error = std::current_exception();
+        }
+        for (size_t i=0; i<batch.size(); i++) {
+            if (error) {
+                batch[i].result.set_exception(error);
+            }
+            else {
+                batch[i].result.set_value(std::move(detections[i]));
+            }
+        }
+        auto finished = std::chrono::steady_clock::now();
+
+        {
+            const std::lock_guard<std::mutex> lock (stats_mutex);
+            stats.batches++;
+            stats.frames += batch.size();
+            stats.deadline_flushes += deadline ? 1 : 0;
+            batch_size.add((double)batch.size());
+            forward_ms.add(std::chrono::duration<double, std::milli>(finished - started).count());
+            for (auto &request : batch) {
+                wait_ms.add(std::chrono::duration<double, std::milli>(started - request.submitted).count());
+            }
+        }
+        batch.clear();
+    }
+}
+
+// ======================================================================================
+
+BatchedDetector::BatchedDetector (BatchScheduler &batchScheduler)
+    : scheduler(batchScheduler) {
+}
+
+// --------------------------------------------------------------------------------------
+
+void BatchedDetector::detect (const cv::Mat &frame, Detections &detections) {
+
+    detections = scheduler.submit(frame).get();
+}
+
+// --------------------------------------------------------------------------------------
+
+void BatchedDetector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Submit the shared input sized image, then map the boxes back to the frame
+    */
+
+    cv::Size input_size = scheduler.getInputSize();
+    detections = scheduler.submit(products.resized(input_size)).get();
+    for (auto &box : detections.boxes) {
+        box = products.mapToFrame(box, input_size);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size BatchedDetector::getInputSize () {
+
+    return scheduler.getInputSize();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "blobkernel.hpp"
+#include "detector.hpp"
+#include "framemetadata.hpp"
+#include "yolodecoder.hpp"
+
+struct BatchStats {
+    uint64_t batches = 0;
+    uint64_t frames = 0;
+    uint64_t deadline_flushes = 0;
+    double mean_batch = 0.0;
+    double mean_forward_ms = 0.0;
+    double mean_wait_ms = 0.0;
+};
+
+/**
+ * Runs one network for several sources. Frames submitted from any thread are
+ * collected into a single N image blob and run with one forward pass, which keeps the
+ * CPU backend busy on small inputs. A batch is run as soon as it is full, or once the
+ * oldest frame has waited the deadline, so a slow source can't hold the others back.
+*/
+class BatchScheduler {
+    public:
+        BatchScheduler (cv::dnn::Net, cv::Size = cv::Size(320, 320), size_t = 4, double = 10.0);
+        ~BatchScheduler ();
+        void start ();
+        void stop ();
+        std::future<Detections> submit (const cv::Mat &);
+        void detect (const std::vector<cv::Mat> &, std::vector<Detections> &);
+        cv::Size getInputSize ();
+        YoloDecoder& getDecoder ();
+        BatchStats getStats ();
+        std::string printStats ();
+
+    protected:
+        struct Request {
+            cv::Mat frame;
+            std::promise<Detections> result;
+            std::chrono::steady_clock::time_point submitted;
+        };
+
+        void run (std::stop_token);
+
+        cv::dnn::Net net;
+        cv::Size input_size;
+        size_t max_batch;
+        std::chrono::microseconds max_wait;
+        YoloDecoder decoder;
+        std::vector<std::string> out_names;
+        std::vector<cv::Mat> outs;
+        cv::Mat blob;
+        BlobKernel blob_kernel;
+
+        std::deque<Request> pending;
+        bool running;
+        std::mutex pending_mutex;
+        std::condition_variable_any pending_cond;
+        std::jthread thread;
+
+        std::mutex stats_mutex;
+        BatchStats stats;
+        RollingStat batch_size;
+        RollingStat forward_ms;
+        RollingStat wait_ms;
+};
+
+/**
+ * Detector which hands its frames to a shared BatchScheduler, so each source can
+ * keep using the Detector interface from its own thread
+*/
+class BatchedDetector: public Detector {
+    public:
+        BatchedDetector (BatchScheduler &);
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        cv::Size getInputSize ();
+
+    protected:
+        BatchScheduler &scheduler;
+};
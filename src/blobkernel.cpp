@@ -0,0 +1,189 @@
+#include "blobkernel.hpp"
+
+
+BlobKernel::BlobKernel () {
+}
+
+// --------------------------------------------------------------------------------------
+
+void BlobKernel::run (const cv::Mat &frame, cv::Mat &blob, cv::Size size, double scale, bool swapRB) {
+    /**
+     * Build a one image blob
+     * @param frame - 8 bit, 3 channel frame
+     * @param blob - receives the 1x3xHxW float blob, reallocated only if its shape changes
+     * @param size - network input size
+     * @param scale - multiplier applied to each pixel value
+     * @param swapRB - swap the red and blue channels
+    */
+
+    CV_Assert(supports(frame));
+    int sizes[] = {1, 3, size.height, size.width};
+    blob.create(4, sizes, CV_32F);
+
+    buildTables(frame.size(), size);
+    convert(frame, blob.ptr<float>(), (float)scale, swapRB);
+}
+
+// --------------------------------------------------------------------------------------
+
+void BlobKernel::runBatch (const std::vector<cv::Mat> &frames, cv::Mat &blob, cv::Size size, double scale, bool swapRB) {
+    /**
+     * Build an N image blob, the frames may differ in size
+     * @param frames - 8 bit, 3 channel frames
+     * @param blob - receives the Nx3xHxW float blob, reallocated only if its shape changes
+    */
+
+    int sizes[] = {(int)frames.size(), 3, size.height, size.width};
+    blob.create(4, sizes, CV_32F);
+
+    size_t image_floats = 3 * (size_t)size.area();
+    for (size_t i=0; i<frames.size(); i++) {
+        CV_Assert(supports(frames[i]));
+        buildTables(frames[i].size(), size);
+        convert(frames[i], blob.ptr<float>() + i * image_floats, (float)scale, swapRB);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+bool BlobKernel::supports (const cv::Mat &frame) {
+    /**
+     * @returns true if the frame is a type the kernel handles, otherwise use blobFromImage
+    */
+
+    return frame.type() == CV_8UC3 && frame.dims == 2 && !frame.empty();
+}
+
+// --------------------------------------------------------------------------------------
+
+void BlobKernel::buildTables (cv::Size sourceSize, cv::Size outputSize) {
+    /**
+     * Source pixels and weights for every output column and row, placed the way
+     * cv::resize INTER_LINEAR places them. Only rebuilt when a size changes.
+    */
+
+    if (sourceSize == source_size && outputSize == output_size) {
+        return;
+    }
+    source_size = sourceSize;
+    output_size = outputSize;
+
+    auto build = [] (int source, int output, std::vector<int> &low, std::vector<int> &high, std::vector<float> &weight) {
+        low.resize(output);
+        high.resize(output);
+        weight.resize(output);
+        double ratio = (double)source / output;
+        for (int i=0; i<output; i++) {
+            float position = (float)((i + 0.5) * ratio - 0.5);
+            int first = cvFloor(position);
+            float w = position - first;
+            if (first < 0) {
+                first = 0;
+                w = 0.0f;
+            }
+            if (first >= source - 1) {
+                first = source - 1;
+                w = 0.0f;
+            }
+            low[i] = first;
+            high[i] = std::min(first + 1, source - 1);
+            weight[i] = w;
+        }
+    };
+
+    build(source_size.width, output_size.width, x_left, x_right, x_weight);
+    build(source_size.height, output_size.height, y_top, y_bottom, y_weight);
+
+    // Store the columns as byte offsets into a BGR row
+    for (int x=0; x<output_size.width; x++) {
+        x_left[x] *= 3;
+        x_right[x] *= 3;
+    }
+
+    top_row.resize(3 * output_size.width);
+    bottom_row.resize(3 * output_size.width);
+}
+
+// --------------------------------------------------------------------------------------
+
+void BlobKernel::convert (const cv::Mat &frame, float* planes, float scale, bool swapRB) {
+    /**
+     * Fill the three planes of one image, an output row at a time
+    */
+
+    int top_loaded = -1, bottom_loaded = -1;
+    size_t plane_floats = (size_t)output_size.area();
+
+    for (int y=0; y<output_size.height; y++) {
+        int top = y_top[y];
+        int bottom = y_bottom[y];
+
+        // Consecutive output rows mostly share source rows when upscaling
+        if (top != top_loaded) {
+            if (top == bottom_loaded) {
+                std::swap(top_row, bottom_row);
+                std::swap(top_loaded, bottom_loaded);
+            }
+            else {
+                horizontal(frame.ptr<uchar>(top), top_row.data(), swapRB);
+                top_loaded = top;
+            }
+        }
+        if (bottom != bottom_loaded) {
+            horizontal(frame.ptr<uchar>(bottom), bottom_row.data(), swapRB);
+            bottom_loaded = bottom;
+        }
+
+        for (int c=0; c<3; c++) {
+            size_t row_offset = (size_t)c * output_size.width;
+            blend(top_row.data() + row_offset, bottom_row.data() + row_offset, y_weight[y], scale,
+                planes + c * plane_floats + (size_t)y * output_size.width);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void BlobKernel::horizontal (const uchar* source, float* row, bool swapRB) {
+    /**
+     * Interpolate one source row to the output width, splitting it into channel planes
+    */
+
+    int width = output_size.width;
+    float* first = row + (swapRB ? 2 * width : 0);
+    float* second = row + width;
+    float* third = row + (swapRB ? 0 : 2 * width);
+
+    for (int x=0; x<width; x++) {
+        const uchar* left = source + x_left[x];
+        const uchar* right = source + x_right[x];
+        float w = x_weight[x];
+        first[x] = left[0] + (right[0] - left[0]) * w;
+        second[x] = left[1] + (right[1] - left[1]) * w;
+        third[x] = left[2] + (right[2] - left[2]) * w;
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void BlobKernel::blend (const float* top, const float* bottom, float weight, float scale, float* out) {
+    /**
+     * Vertical interpolation and scaling of one plane row, written straight into the blob
+    */
+
+    int width = output_size.width;
+    int x = 0;
+#if CV_SIMD
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    cv::v_float32 weight_vector = cv::vx_setall_f32(weight);
+    cv::v_float32 scale_vector = cv::vx_setall_f32(scale);
+    for (; x<=width - lanes; x+=lanes) {
+        cv::v_float32 t = cv::vx_load(top + x);
+        cv::v_float32 b = cv::vx_load(bottom + x);
+        cv::v_store(out + x, cv::v_fma(b - t, weight_vector, t) * scale_vector);
+    }
+#endif
+    for (; x<width; x++) {
+        out[x] = (top[x] + (bottom[x] - top[x]) * weight) * scale;
+    }
+}
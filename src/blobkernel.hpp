@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+/**
+ * Builds a detector input blob straight from a BGR8 frame in one pass: bilinear
+ * resize, channel swap, float conversion and scaling happen together, writing each
+ * output row of the NCHW planes once. The only intermediates are two rows of
+ * horizontally interpolated source, and the blob is reused from call to call.
+ * Matches cv::dnn::blobFromImage with crop off and no mean subtraction, to within
+ * the rounding of its 8 bit resize.
+*/
+class BlobKernel {
+    public:
+        BlobKernel ();
+        void run (const cv::Mat &, cv::Mat &, cv::Size, double = 1.0/255, bool = false);
+        void runBatch (const std::vector<cv::Mat> &, cv::Mat &, cv::Size, double = 1.0/255, bool = false);
+        static bool supports (const cv::Mat &);
+
+    protected:
+        void buildTables (cv::Size, cv::Size);
+        void convert (const cv::Mat &, float*, float, bool);
+        void horizontal (const uchar*, float*, bool);
+        void blend (const float*, const float*, float, float, float*);
+
+        cv::Size source_size;
+        cv::Size output_size;
+        std::vector<int> x_left;
+        std::vector<int> x_right;
+        std::vector<float> x_weight;
+        std::vector<int> y_top;
+        std::vector<int> y_bottom;
+        std::vector<float> y_weight;
+        std::vector<float> top_row;
+        std::vector<float> bottom_row;
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <thread>
+
+/**
+ * What a full queue does with a new item.
+ * BLOCK - the producer waits for space
+ * DROP_OLDEST - the oldest queued item is discarded to make room
+*/
+enum class QueuePolicy {BLOCK, DROP_OLDEST};
+
+/**
+ * Bounded lock free queue (Vyukov's array based MPMC design). Each cell carries a 
+ * sequence number telling producers and consumers whether it is free or filled, 
+ * so neither side ever takes a lock. A DROP_OLDEST producer makes room by popping
+ * like any other consumer. Blocking calls spin briefly, then yield, then sleep.
+*/
+template <typename T>
+class BoundedQueue {
+    public:
+        BoundedQueue (size_t, QueuePolicy = QueuePolicy::BLOCK);
+        bool tryPush (T &);
+        bool tryPop (T &);
+        bool push (T, std::stop_token = std::stop_token());
+        bool pop (T &, std::stop_token = std::stop_token(), double = -1.0);
+        size_t size ();
+        size_t capacity ();
+        QueuePolicy getPolicy ();
+        uint64_t getPushed ();
+        uint64_t getDropped ();
+
+    protected:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+        static void backoff (int);
+
+        std::unique_ptr<Cell[]> cells;
+        size_t mask;
+        QueuePolicy policy;
+        alignas(64) std::atomic<size_t> enqueue_pos;
+        alignas(64) std::atomic<size_t> dequeue_pos;
+        alignas(64) std::atomic<uint64_t> pushed;
+        std::atomic<uint64_t> dropped;
+};
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue (size_t requestedCapacity, QueuePolicy queuePolicy) {
+    /**
+     * @param requestedCapacity - rounded up to a power of two, at least 2
+     * @param queuePolicy - behavior when full
+    */
+
+    size_t size = 2;
+    while (size < requestedCapacity) {
+        size *= 2;
+    }
+    
+    cells = std::make_unique<Cell[]>(size);
+    for (size_t i=0; i<size; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = size - 1;
+    policy = queuePolicy;
+    enqueue_pos.store(0, std::memory_order_relaxed);
+    dequeue_pos.store(0, std::memory_order_relaxed);
+    pushed.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+bool BoundedQueue<T>::tryPush (T &item) {
+    /**
+     * Push without waiting
+     * @param item - moved into the queue on success
+     * @returns false if the queue is full
+    */
+
+    Cell* cell;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+        
+        if (difference == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (difference < 0) {
+            return false;
+        }
+        else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+bool BoundedQueue<T>::tryPop (T &item) {
+    /**
+     * Pop without waiting
+     * @param item - receives the oldest item
+     * @returns false if the queue is empty
+    */
+
+    Cell* cell;
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)(pos + 1);
+        
+        if (difference == 0) {
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (difference < 0) {
+            return false;
+        }
+        else {
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    item = std::move(cell->data);
+    // Don't keep a moved-from item's resources alive in the cell
+    cell->data = T();
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+void BoundedQueue<T>::backoff (int attempt) {
+    
+    if (attempt < 64) {
+        return;
+    }
+    if (attempt < 256) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+bool BoundedQueue<T>::push (T item, std::stop_token stopToken) {
+    /**
+     * Push according to the queue policy
+     * @param item - item to push
+     * @param stopToken - ends a BLOCK wait early
+     * @returns false if stopped before the item was queued
+    */
+
+    pushed.fetch_add(1, std::memory_order_relaxed);
+    for (int attempt=0; ; attempt++) {
+        if (tryPush(item)) {
+            return true;
+        }
+        
+        if (policy == QueuePolicy::DROP_OLDEST) {
+            T discarded;
+            if (tryPop(discarded)) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        
+        if (stopToken.stop_requested()) {
+            return false;
+        }
+        backoff(attempt);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+bool BoundedQueue<T>::pop (T &item, std::stop_token stopToken, double timeoutSeconds) {
+    /**
+     * Wait for an item
+     * @param item - receives the oldest item
+     * @param stopToken - ends the wait early
+     * @param timeoutSeconds - how long to wait, negative to wait until stopped
+     * @returns false if stopped or timed out
+    */
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((long long)(timeoutSeconds * 1000000));
+    for (int attempt=0; ; attempt++) {
+        if (tryPop(item)) {
+            return true;
+        }
+        if (stopToken.stop_requested()) {
+            return false;
+        }
+        if (timeoutSeconds >= 0.0 && std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        backoff(attempt);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+size_t BoundedQueue<T>::size () {
+    /**
+     * Approximate number of queued items
+    */
+
+    size_t enqueued = enqueue_pos.load(std::memory_order_relaxed);
+    size_t dequeued = dequeue_pos.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+size_t BoundedQueue<T>::capacity () {
+    
+    return mask + 1;
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+QueuePolicy BoundedQueue<T>::getPolicy () {
+    
+    return policy;
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+uint64_t BoundedQueue<T>::getPushed () {
+    
+    return pushed.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------------------
+
+template <typename T>
+uint64_t BoundedQueue<T>::getDropped () {
+    
+    return dropped.load(std::memory_order_relaxed);
+}
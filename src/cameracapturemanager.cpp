@@ -2,6 +2,10 @@
 
 
 CameraCaptureManager::CameraCaptureManager (void) {
+    recorder = nullptr;
+    frame_bus = nullptr;
+    driver_timestamps = true;
+    decode_scale = 1;
 }
 
 // -------------------------------------------------------------------------
@@ -26,17 +30,215 @@ int CameraCaptureManager:: open (int source, int api) {
 
     // Set the default properties
     setDefaultProperties();
+
+    // Apply a reduced decode requested before the camera was open
+    if (decode_scale > 1) {
+        setReducedDecode(decode_scale);
+    }
     return 0;
 }
 
 // -------------------------------------------------------------------------
 
 bool CameraCaptureManager:: read (cv::OutputArray& frame) {
+    FrameMetadata metadata;
+    return read(frame, metadata);
+}
+
+// -------------------------------------------------------------------------
+
+bool CameraCaptureManager:: read (cv::OutputArray& frame, FrameMetadata& metadata) {
+    //! Read a frame and fill in its sequence number, grab time and driver timestamp
+    
+    if (!cap) {
+        return false;
+    }
+
+    if (decode_scale > 1) {
+        // A fresh buffer each frame, so consumers can keep the encoded data
+        cv::Mat encoded;
+        if (!cap->read(encoded)) {
+            return false;
+        }
+        last_encoded = encoded;
+        
+        if (frame.kind() == cv::_InputArray::MAT) {
+            if (!decodeMjpeg(encoded, decode_scale, frame.getMatRef())) {
+                return false;
+            }
+        }
+        else {
+            cv::Mat decoded;
+            if (!decodeMjpeg(encoded, decode_scale, decoded)) {
+                return false;
+            }
+            frame.assign(decoded);
+        }
+    }
+    else if (!cap->read(frame)) {
+        return false;
+    }
+
+    metadata.sequence = ++frame_sequence;
+    metadata.grab_time = std::chrono::steady_clock::now();
+    metadata.driver_timestamp = -1.0;
+    
+    // Stop asking once the backend shows it doesn't report positions
+    if (driver_timestamps) {
+        double position = cap->get(cv::CAP_PROP_POS_MSEC);
+        if (position > 0.0) {
+            metadata.driver_timestamp = position;
+        }
+        else if (frame_sequence > 1) {
+            driver_timestamps = false;
+        }
+    }
+
+    // Timestamps are recorded in milliseconds since the first recorded frame
+    if (recorder) {
+        if (recorder->getFrameCount() == 0) {
+            record_start = metadata.grab_time;
+        }
+        recorder->write(frame.getMat(), std::chrono::duration<double, std::milli>(metadata.grab_time - record_start).count());
+    }
+
+    if (frame_bus) {
+        frame_bus->publish(frame.getMat(), metadata);
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+bool CameraCaptureManager::readDual (DualStreamFrame& dual, int lowResScale) {
+    //! In reduced decode mode the decoded frame is the low resolution stream and the
+    //! full frame is decoded from the compressed buffer only when asked for.
+    //! Otherwise the frame is downsized by lowResScale.
+
+    if (decode_scale <= 1) {
+        return CaptureManager::readDual(dual, lowResScale);
+    }
+
+    cv::Mat frame;
+    FrameMetadata metadata;
+    if (!read(frame, metadata)) {
+        return false;
+    }
+    
+    dual.reset(frame, capture_size, metadata, cv::Mat(), getEncoded());
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+void CameraCaptureManager::setRecorder (RawFrameRecorder *rawRecorder) {
+    //! Write every frame read to the given recorder. Pass nullptr to stop recording.
+
+    recorder = rawRecorder;
+}
+
+// -------------------------------------------------------------------------
+
+void CameraCaptureManager::setFrameBus (FrameBusWriter *writer) {
+    //! Publish every frame read to a shared memory frame bus, so other local 
+    //! processes can see the camera without opening it. Pass nullptr to stop.
+
+    frame_bus = writer;
+}
+
+// -------------------------------------------------------------------------
+
+bool CameraCaptureManager::setReducedDecode (int scale) {
+    /**
+     * Have the driver deliver the compressed MJPG buffer and decode it with DCT
+     * scaling straight to 1/scale of the capture size. The detector never needs 
+     * the full 1600x896 frame, so most of the decode work is skipped. 
+     * Call before open when a grab thread will be reading the camera.
+     * @param scale - 1 (full decode by the driver), 2, 4 or 8
+     * @returns false if the backend can't deliver compressed frames. Full decode stays in use.
+    */
+
     if (!cap) {
+        decode_scale = scale;
+        return true;
+    }
+    
+    if (scale != 2 && scale != 4 && scale != 8) {
+        cap->set(cv::CAP_PROP_CONVERT_RGB, 1);
+        cap->set(cv::CAP_PROP_FORMAT, CV_8UC3);
+        decode_scale = 1;
+        last_encoded.release();
+        return scale == 1;
+    }
+
+    // V4L2 and FFMPEG use FORMAT = -1 for raw mode, DSHOW and MSMF turn off conversion
+    cap->set(cv::CAP_PROP_FORMAT, -1);
+    cap->set(cv::CAP_PROP_CONVERT_RGB, 0);
+
+    // A compressed frame comes back as a single row of bytes
+    cv::Mat test;
+    if (!cap->read(test) || test.rows != 1 || test.type() != CV_8UC1) {
+        spdlog::warn("Camera backend does not deliver compressed frames, reduced decode disabled");
+        setReducedDecode(1);
         return false;
     }
+    
+    decode_scale = scale;
+    capture_size = cv::Size((int)cap->get(cv::CAP_PROP_FRAME_WIDTH), (int)cap->get(cv::CAP_PROP_FRAME_HEIGHT));
+    return true;
+}
+
+// -------------------------------------------------------------------------
 
-    return cap->read(frame);
+int CameraCaptureManager::getDecodeScale () {
+    
+    return decode_scale;
+}
+
+// -------------------------------------------------------------------------
+
+cv::Mat CameraCaptureManager::getEncoded () {
+    //! Compressed buffer of the last frame read in reduced decode mode, empty otherwise
+    
+    return last_encoded;
+}
+
+// -------------------------------------------------------------------------
+
+bool CameraCaptureManager::decodeFullResolution (cv::Mat &frame) {
+    //! Decode the last frame read at full resolution, e.g. for display or a snapshot
+
+    return decodeMjpeg(getEncoded(), 1, frame);
+}
+
+// -------------------------------------------------------------------------
+
+bool CameraCaptureManager::decodeMjpeg (const cv::Mat &encoded, int scale, cv::Mat &frame) {
+    /**
+     * Decode a JPEG buffer, scaled down by the JPEG decoder itself
+     * @param encoded - compressed buffer
+     * @param scale - 1, 2, 4 or 8
+     * @param frame - decoded frame, reused if already the right size
+     * @returns false if the buffer fails to decode
+    */
+
+    if (encoded.empty()) {
+        return false;
+    }
+
+    int flags = cv::IMREAD_COLOR;
+    switch (scale) {
+        case 2: flags = cv::IMREAD_REDUCED_COLOR_2; break;
+        case 4: flags = cv::IMREAD_REDUCED_COLOR_4; break;
+        case 8: flags = cv::IMREAD_REDUCED_COLOR_8; break;
+    }
+
+    cv::imdecode(encoded, flags, &frame);
+    if (frame.empty()) {
+        spdlog::warn("Failed to decode MJPG frame");
+        return false;
+    }
+    return true;
 }
 
 // -------------------------------------------------------------------------
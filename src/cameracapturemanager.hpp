@@ -5,10 +5,14 @@
 
 
 #include "capturemanager.hpp"
+#include "rawframefile.hpp"
+#include "framebus.hpp"
 #include<iostream>
 #include <unordered_map>
 #include <sstream>
+#include <chrono>
 #include<opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
 using namespace std;
 
 using properties = unordered_map<string, double>;
@@ -20,14 +24,30 @@ class CameraCaptureManager: public CaptureManager{
         ~CameraCaptureManager (void);
         int open (int, int = cv::CAP_DSHOW);
         bool read (cv::OutputArray&); 
+        bool read (cv::OutputArray&, FrameMetadata&);
+        bool readDual (DualStreamFrame&, int = 2);
         void setDefaultProperties ();
         void setProperties (properties);
         properties getProperties ();
         string decodeFourccValue (double);
         string printProperties (properties);
+        void setRecorder (RawFrameRecorder *);
+        void setFrameBus (FrameBusWriter *);
+        bool setReducedDecode (int);
+        int getDecodeScale ();
+        virtual cv::Mat getEncoded ();
+        bool decodeFullResolution (cv::Mat &);
+        static bool decodeMjpeg (const cv::Mat &, int, cv::Mat &);
         
     protected:
         propmapping property_mapping;  
+        RawFrameRecorder* recorder;
+        FrameBusWriter* frame_bus;
+        std::chrono::steady_clock::time_point record_start;
+        bool driver_timestamps;
+        int decode_scale;
+        cv::Size capture_size;
+        cv::Mat last_encoded;
     private:
        
 };
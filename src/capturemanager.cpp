@@ -2,6 +2,7 @@
 
 CaptureManager::CaptureManager () {
     cap = nullptr;
+    frame_sequence = 0;
 }
 
 // -----------------------------------------------------------------------
@@ -25,11 +26,66 @@ int CaptureManager::open (int source, int api /*=CAP_DSHOW*/) {
 
 // -----------------------------------------------------------------------
 
+bool CaptureManager::read (cv::OutputArray& frame, FrameMetadata& metadata) {
+    //! Read a frame and stamp it with a sequence number and grab time. 
+    //! Sources with their own clock override this to fill in the driver timestamp.
+
+    if (!read(frame)) {
+        return false;
+    }
+    
+    metadata.sequence = ++frame_sequence;
+    metadata.grab_time = std::chrono::steady_clock::now();
+    metadata.driver_timestamp = -1.0;
+    return true;
+}
+
+// -----------------------------------------------------------------------
+
+bool CaptureManager::readProducts (FrameProducts& products) {
+    //! Read a frame and start a new set of derived products for it, 
+    //! so every consumer shares the same resized and converted images.
+
+    cv::Mat frame;
+    FrameMetadata metadata;
+    if (!read(frame, metadata)) {
+        return false;
+    }
+
+    products.reset(frame, metadata);
+    return true;
+}
+
+// -----------------------------------------------------------------------
+
+bool CaptureManager::readDual (DualStreamFrame& dual, int lowResScale /*=2*/) {
+    //! Read a frame as a low resolution detection stream, reduced by lowResScale,
+    //! with the full frame kept for crops
+
+    cv::Mat frame;
+    FrameMetadata metadata;
+    if (!read(frame, metadata)) {
+        return false;
+    }
+
+    cv::Mat low_res = frame;
+    if (lowResScale > 1) {
+        cv::Size low_size = cv::Size((frame.cols + lowResScale - 1) / lowResScale, (frame.rows + lowResScale - 1) / lowResScale);
+        cv::resize(frame, low_res, low_size, 0, 0, cv::INTER_AREA);
+    }
+    
+    dual.reset(low_res, frame.size(), metadata, frame);
+    return true;
+}
+
+// -----------------------------------------------------------------------
+
 void CaptureManager::close (void) {
     if (cap) {
         cout << "releasing" << endl;
         cap->release();
         delete cap;
+        cap = nullptr;
     }
     else {
         cout << "not allocated" << endl;
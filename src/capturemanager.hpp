@@ -5,17 +5,25 @@
 
 #include<iostream>
 #include<opencv2/opencv.hpp>
+#include "framemetadata.hpp"
+#include "frameproducts.hpp"
+#include "dualstreamframe.hpp"
 using namespace std;
 
 class CaptureManager {
     public:
         CaptureManager (void);
-        ~CaptureManager (void);
-        int open(int, int api=cv::CAP_DSHOW);
-        void close(void);
+        virtual ~CaptureManager (void);
+        virtual int open(int, int api=cv::CAP_DSHOW);
+        virtual bool read(cv::OutputArray&) = 0;
+        virtual bool read(cv::OutputArray&, FrameMetadata&);
+        bool readProducts(FrameProducts&);
+        virtual bool readDual(DualStreamFrame&, int = 2);
+        virtual void close(void);
         
     protected:
         cv::VideoCapture* cap; 
+        uint64_t frame_sequence;
 };
 
-#endif
\ No newline at end of file
+#endif
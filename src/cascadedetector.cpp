@@ -0,0 +1,114 @@
+#include "cascadedetector.hpp"
+
+
+CascadeDetector::CascadeDetector (Detector &firstStage, Detector &secondStage, int targetClass,
+    float lowConfidence, float highConfidence) : first(firstStage), second(secondStage) {
+
+    /**
+     * @param firstStage - cheap detector, thresholded at lowConfidence by the caller
+     * @param secondStage - accurate detector
+     * @param targetClass - class whose confidence decides between the stages
+     * @param lowConfidence - bottom of the ambiguous band
+     * @param highConfidence - top of the ambiguous band
+    */
+
+    target_class = targetClass;
+    low_confidence = lowConfidence;
+    high_confidence = highConfidence;
+    escalated = false;
+}
+
+// --------------------------------------------------------------------------------------
+
+void CascadeDetector::detect (const cv::Mat &frame, Detections &detections) {
+
+    step(detections, [&] (Detector &stage, Detections &found) { stage.detect(frame, found); });
+}
+
+// --------------------------------------------------------------------------------------
+
+void CascadeDetector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Both stages share the frame's products
+    */
+
+    step(detections, [&] (Detector &stage, Detections &found) { stage.detect(products, found); });
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size CascadeDetector::getInputSize () {
+
+    return first.getInputSize();
+}
+
+// --------------------------------------------------------------------------------------
+
+bool CascadeDetector::wasEscalated () {
+    /**
+     * Whether the last frame needed the second stage
+    */
+
+    return escalated;
+}
+
+// --------------------------------------------------------------------------------------
+
+CascadeStats CascadeDetector::getStats () {
+
+    CascadeStats s = stats;
+    s.mean_first_ms = first_ms.mean();
+    s.mean_second_ms = second_ms.mean();
+    return s;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string CascadeDetector::printStats () {
+
+    CascadeStats s = getStats();
+    std::ostringstream oss;
+    oss << s.frames << " frames, first stage " << s.mean_first_ms << "ms, accepted: " << s.accepted
+        << ", rejected: " << s.rejected << ", second stage: " << s.escalated << " runs, "
+        << s.mean_second_ms << "ms";
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+void CascadeDetector::step (Detections &detections, const std::function<void (Detector &, Detections &)> &run) {
+    /**
+     * Run the first stage, then the second if the target's confidence is ambiguous
+     * @param detections - the boxes of whichever stage decided
+     * @param run - runs a stage on the frame
+    */
+
+    stats.frames++;
+    utils::Timer timer;
+    run(first, first_detections);
+    first_ms.add(timer.seconds() * 1000);
+
+    int best = first_detections.find(target_class);
+    float confidence = best >= 0 ? first_detections.confidences[best] : 0.0f;
+    escalated = confidence >= low_confidence && confidence < high_confidence;
+    if (escalated) {
+        stats.escalated++;
+        timer.start();
+        run(second, detections);
+        second_ms.add(timer.seconds() * 1000);
+        return;
+    }
+
+    if (confidence >= high_confidence) {
+        stats.accepted++;
+    }
+    else {
+        stats.rejected++;
+    }
+    detections.clear();
+    for (size_t i=0; i<first_detections.size(); i++) {
+        if (first_detections.confidences[i] >= high_confidence) {
+            detections.add(first_detections.class_ids[i], first_detections.confidences[i], first_detections.boxes[i]);
+        }
+    }
+}
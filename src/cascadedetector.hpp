@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+#include "detector.hpp"
+#include "framemetadata.hpp"
+#include "utils.hpp"
+
+struct CascadeStats {
+    uint64_t frames = 0;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t escalated = 0;
+    double mean_first_ms = 0.0;
+    double mean_second_ms = 0.0;
+};
+
+/**
+ * Two stage detector. The cheap first stage runs every frame with its confidence
+ * threshold at the bottom of the ambiguous band. When its best target class box is
+ * at or above the top of the band its boxes are kept, those above the band; below
+ * the band there's no target. Only in between does the accurate second stage run,
+ * on the whole frame, and its boxes are used instead.
+*/
+class CascadeDetector: public Detector {
+    public:
+        CascadeDetector (Detector &, Detector &, int, float = 0.3, float = 0.5);
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        cv::Size getInputSize ();
+        bool wasEscalated ();
+        CascadeStats getStats ();
+        std::string printStats ();
+
+    protected:
+        void step (Detections &, const std::function<void (Detector &, Detections &)> &);
+
+        Detector &first;
+        Detector &second;
+        int target_class;
+        float low_confidence;
+        float high_confidence;
+        bool escalated;
+        Detections first_detections;
+        CascadeStats stats;
+        RollingStat first_ms;
+        RollingStat second_ms;
+};
@@ -0,0 +1,128 @@
+#include "detector.hpp"
+
+
+void Detections::clear () {
+    
+    class_ids.clear();
+    confidences.clear();
+    boxes.clear();
+}
+
+// --------------------------------------------------------------------------------------
+
+size_t Detections::size () const {
+    
+    return class_ids.size();
+}
+
+// --------------------------------------------------------------------------------------
+
+void Detections::add (int classId, float confidence, cv::Rect box) {
+    
+    class_ids.push_back(classId);
+    confidences.push_back(confidence);
+    boxes.push_back(box);
+}
+
+// --------------------------------------------------------------------------------------
+
+int Detections::find (int classId) const {
+    /**
+     * Index of the most confident detection of a class
+     * @param classId - class to look for
+     * @returns index, or -1 if the class wasn't detected
+    */
+
+    int best = -1;
+    for (size_t i=0; i<class_ids.size(); i++) {
+        if (class_ids[i] == classId && (best < 0 || confidences[i] > confidences[best])) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+// ======================================================================================
+
+void Detector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Detect on a frame's shared products. The default runs on the frame itself;
+     * detectors which can use a cached derived image override this.
+    */
+
+    detect(products.frame(), detections);
+}
+
+// ======================================================================================
+
+DnnDetector::DnnDetector (std::string config, std::string weights, cv::Size inputSize, int backend, int target)
+    : DnnDetector(cv::dnn::readNetFromDarknet(config, weights), inputSize) {
+
+    /**
+     * Load a Darknet model
+     * @param config - .cfg file
+     * @param weights - .weights file
+     * @param inputSize - network input size
+     * @param backend - cv::dnn backend
+     * @param target - cv::dnn target
+    */
+
+    net.setPreferableBackend(backend);
+    net.setPreferableTarget(target);
+}
+
+// --------------------------------------------------------------------------------------
+
+DnnDetector::DnnDetector (cv::dnn::Net network, cv::Size inputSize) 
+    : net(network), model(network) {
+    
+    input_size = inputSize;
+    model.setInputParams(1.0/255, input_size);
+    
+    // DetectionModel's defaults
+    confidence_threshold = 0.5;
+    nms_threshold = 0.0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void DnnDetector::detect (const cv::Mat &frame, Detections &detections) {
+    
+    model.detect(frame, detections.class_ids, detections.confidences, detections.boxes, confidence_threshold, nms_threshold);
+}
+
+// --------------------------------------------------------------------------------------
+
+void DnnDetector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Detect on the shared input sized image, then map the boxes back to the frame
+    */
+
+    model.detect(products.resized(input_size), detections.class_ids, detections.confidences, detections.boxes, 
+        confidence_threshold, nms_threshold);
+    for (auto &box : detections.boxes) {
+        box = products.mapToFrame(box, input_size);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size DnnDetector::getInputSize () {
+    
+    return input_size;
+}
+
+// --------------------------------------------------------------------------------------
+
+void DnnDetector::setThresholds (float confidenceThreshold, float nmsThreshold) {
+    
+    confidence_threshold = confidenceThreshold;
+    nms_threshold = nmsThreshold;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::dnn::Net& DnnDetector::getNet () {
+    
+    return net;
+}
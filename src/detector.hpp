@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "frameproducts.hpp"
+
+/**
+ * Detector output as parallel vectors, the same shape cv::dnn::DetectionModel uses
+*/
+struct Detections {
+    std::vector<int> class_ids;
+    std::vector<float> confidences;
+    std::vector<cv::Rect> boxes;
+
+    void clear ();
+    size_t size () const;
+    void add (int, float, cv::Rect);
+    int find (int) const;
+};
+
+/**
+ * Interface the rest of the pipeline uses to run object detection, so stages don't
+ * depend on a particular model or post-processing. Boxes are in frame coordinates.
+*/
+class Detector {
+    public:
+        virtual ~Detector () = default;
+        virtual void detect (const cv::Mat &, Detections &) = 0;
+        virtual void detect (FrameProducts &, Detections &);
+        virtual cv::Size getInputSize () = 0;
+};
+
+/**
+ * Detector backed by cv::dnn::DetectionModel
+*/
+class DnnDetector: public Detector {
+    public:
+        DnnDetector (std::string, std::string, cv::Size = cv::Size(320, 320), 
+            int = cv::dnn::DNN_BACKEND_OPENCV, int = cv::dnn::DNN_TARGET_CPU);
+        DnnDetector (cv::dnn::Net, cv::Size = cv::Size(320, 320));
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        cv::Size getInputSize ();
+        virtual void setThresholds (float, float);
+        cv::dnn::Net& getNet ();
+    protected:
+        cv::dnn::Net net;
+        cv::dnn::DetectionModel model;
+        cv::Size input_size;
+        float confidence_threshold;
+        float nms_threshold;
+};
@@ -0,0 +1,261 @@
+#include "dnnautotuner.hpp"
+
+
+Json::Value DnnProfile::toJson () const {
+
+    Json::Value root;
+    root["backend"] = backend;
+    root["target"] = target;
+    root["threads"] = threads;
+    root["input_width"] = input_size.width;
+    root["input_height"] = input_size.height;
+    root["mean_ms"] = mean_ms;
+    root["cpu_features"] = cpu_features;
+    root["cpus"] = cpus;
+    return root;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool DnnProfile::fromJson (const Json::Value &root, DnnProfile &profile) {
+    /**
+     * @param root - JSON written by toJson
+     * @param profile - filled in if the JSON holds a complete profile
+     * @returns false if any value is missing
+    */
+
+    if (!root.isObject()) {
+        return false;
+    }
+    for (const char* key : {"backend", "target", "threads", "input_width", "input_height", "cpu_features", "cpus"}) {
+        if (!root.isMember(key)) {
+            return false;
+        }
+    }
+
+    profile.backend = root["backend"].asInt();
+    profile.target = root["target"].asInt();
+    profile.threads = root["threads"].asInt();
+    profile.input_size = cv::Size(root["input_width"].asInt(), root["input_height"].asInt());
+    profile.mean_ms = root["mean_ms"].asDouble();
+    profile.cpu_features = root["cpu_features"].asString();
+    profile.cpus = root["cpus"].asInt();
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool DnnProfile::matchesMachine () const {
+    /**
+     * @returns true if the profile was tuned on a machine like this one
+    */
+
+    return cpu_features == cv::getCPUFeaturesLine() && cpus == cv::getNumberOfCPUs();
+}
+
+// --------------------------------------------------------------------------------------
+
+void DnnProfile::apply () const {
+    /**
+     * Set the process wide thread count. Backend, target and input size are passed to
+     * the detectors.
+    */
+
+    cv::setNumThreads(threads);
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string DnnProfile::print () const {
+
+    return "backend " + std::to_string(backend) + ", target " + std::to_string(target) + ", threads "
+        + std::to_string(threads) + ", input " + std::to_string(input_size.width) + "x"
+        + std::to_string(input_size.height) + ", " + std::to_string(mean_ms) + "ms";
+}
+
+// ======================================================================================
+
+DnnAutoTuner::DnnAutoTuner (ModelCache &modelCache, double budgetMs)
+    : model(modelCache) {
+
+    /**
+     * Candidates default to every backend with a CPU target, thread counts from 1 up to
+     * the number of CPUs in powers of two, and inputs of 256, 320 and 416
+     * @param modelCache - the model to tune
+     * @param budgetMs - detection time per frame the chosen input should fit in
+    */
+
+    budget_ms = budgetMs;
+
+    for (auto [backend, target] : cv::dnn::getAvailableBackends()) {
+        if (target == cv::dnn::DNN_TARGET_CPU) {
+            backends.push_back({backend, target});
+        }
+    }
+
+    int cpus = cv::getNumberOfCPUs();
+    for (int threads=1; threads<cpus; threads*=2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(cpus);
+
+    input_sizes = {cv::Size(256, 256), cv::Size(320, 320), cv::Size(416, 416)};
+}
+
+// --------------------------------------------------------------------------------------
+
+void DnnAutoTuner::setBackends (std::vector<std::pair<int,int>> backendTargets) {
+
+    backends = backendTargets;
+}
+
+// --------------------------------------------------------------------------------------
+
+void DnnAutoTuner::setThreadCounts (std::vector<int> threadCounts) {
+
+    thread_counts = threadCounts;
+}
+
+// --------------------------------------------------------------------------------------
+
+void DnnAutoTuner::setInputSizes (std::vector<cv::Size> inputSizes) {
+    /**
+     * @param inputSizes - candidate network inputs, multiples of 32 for YOLO
+    */
+
+    input_sizes = inputSizes;
+}
+
+// --------------------------------------------------------------------------------------
+
+DnnProfile DnnAutoTuner::tune (const std::vector<cv::Mat> &samples, int iterations) {
+    /**
+     * Time every candidate combination
+     * @param samples - frames like the ones the detector will see
+     * @param iterations - timed detections per combination, cycling through the samples
+     * @returns the chosen profile
+    */
+
+    CV_Assert(!samples.empty());
+    int original_threads = cv::getNumThreads();
+
+    DnnProfile fastest, chosen;
+    fastest.mean_ms = chosen.mean_ms = -1;
+    fastest.cpu_features = chosen.cpu_features = cv::getCPUFeaturesLine();
+    fastest.cpus = chosen.cpus = cv::getNumberOfCPUs();
+
+    for (auto [backend, target] : backends) {
+        cv::dnn::Net net;
+        try {
+            net = model.create(backend, target);
+        }
+        catch (const cv::Exception &e) {
+            spdlog::warn("Skipping backend " + std::to_string(backend) + ": " + e.what());
+            continue;
+        }
+
+        for (auto size : input_sizes) {
+            YoloDetector detector(net, size);
+            for (int threads : thread_counts) {
+                cv::setNumThreads(threads);
+                double ms;
+                try {
+                    ms = measure(detector, samples, iterations);
+                }
+                catch (const cv::Exception &e) {
+                    spdlog::warn("Skipping backend " + std::to_string(backend) + " at " + std::to_string(size.width) + ": " + e.what());
+                    break;
+                }
+
+                DnnProfile trial = fastest;
+                trial.backend = backend;
+                trial.target = target;
+                trial.threads = threads;
+                trial.input_size = size;
+                trial.mean_ms = ms;
+                spdlog::info("Tuning: " + trial.print());
+
+                if (fastest.mean_ms < 0 || ms < fastest.mean_ms) {
+                    fastest = trial;
+                }
+
+                // Within the budget a larger input wins, then the faster settings for it
+                bool larger = size.area() > chosen.input_size.area();
+                bool same_faster = size == chosen.input_size && ms < chosen.mean_ms;
+                if (ms <= budget_ms && (chosen.mean_ms < 0 || larger || same_faster)) {
+                    chosen = trial;
+                }
+            }
+        }
+    }
+
+    cv::setNumThreads(original_threads);
+    if (fastest.mean_ms < 0) {
+        throw std::runtime_error("No DNN backend could run the model");
+    }
+    if (chosen.mean_ms < 0) {
+        spdlog::warn("Nothing fits the " + std::to_string(budget_ms) + "ms budget, using the fastest settings");
+        chosen = fastest;
+    }
+    return chosen;
+}
+
+// --------------------------------------------------------------------------------------
+
+DnnProfile DnnAutoTuner::loadOrTune (std::string filename, std::function<std::vector<cv::Mat> ()> samples, bool force) {
+    /**
+     * Use the saved profile if it was tuned on this machine, otherwise tune and save it
+     * @param filename - profile JSON file
+     * @param samples - provides the frames to tune on, only called if tuning
+     * @param force - tune even if a matching profile exists
+    */
+
+    DnnProfile profile;
+    if (!force && load(filename, profile)) {
+        if (profile.matchesMachine()) {
+            spdlog::info("Loaded DNN profile: " + profile.print());
+            return profile;
+        }
+        spdlog::info("DNN profile " + filename + " was tuned on a different machine");
+    }
+
+    spdlog::info("Tuning DNN settings, this takes a while");
+    profile = tune(samples());
+    save(filename, profile);
+    spdlog::info("Saved DNN profile: " + profile.print());
+    return profile;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool DnnAutoTuner::load (std::string filename, DnnProfile &profile) {
+
+    if (!std::filesystem::exists(filename)) {
+        return false;
+    }
+    return DnnProfile::fromJson(utils::readJsonFromFile(filename), profile);
+}
+
+// --------------------------------------------------------------------------------------
+
+void DnnAutoTuner::save (std::string filename, const DnnProfile &profile) {
+
+    utils::writeJsonToFile(filename, profile.toJson());
+}
+
+// --------------------------------------------------------------------------------------
+
+double DnnAutoTuner::measure (YoloDetector &detector, const std::vector<cv::Mat> &samples, int iterations) {
+    /**
+     * Mean milliseconds of a full detection, after a warm up run
+    */
+
+    Detections detections;
+    detector.detect(samples[0], detections);
+
+    utils::Timer timer;
+    for (int i=0; i<iterations; i++) {
+        detector.detect(samples[i % samples.size()], detections);
+    }
+    return timer.seconds() * 1000 / iterations;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <json/json.h>
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "modelcache.hpp"
+#include "utils.hpp"
+#include "yolodecoder.hpp"
+
+/**
+ * The DNN settings that ran fastest on this machine. cpu_features and cpus identify
+ * the machine, so a profile copied to a different box is tuned again.
+*/
+struct DnnProfile {
+    int backend = cv::dnn::DNN_BACKEND_OPENCV;
+    int target = cv::dnn::DNN_TARGET_CPU;
+    int threads = 0;
+    cv::Size input_size = cv::Size(320, 320);
+    double mean_ms = 0.0;
+    std::string cpu_features;
+    int cpus = 0;
+
+    Json::Value toJson () const;
+    static bool fromJson (const Json::Value &, DnnProfile &);
+    bool matchesMachine () const;
+    void apply () const;
+    std::string print () const;
+};
+
+/**
+ * Benchmarks every CPU backend, thread count and input size on sample frames. The
+ * profile chosen is the largest input that detects within the latency budget, using
+ * the fastest backend and thread count for that input. If no input fits the budget,
+ * the fastest combination overall is chosen.
+*/
+class DnnAutoTuner {
+    public:
+        DnnAutoTuner (ModelCache &, double = 50.0);
+        void setBackends (std::vector<std::pair<int,int>>);
+        void setThreadCounts (std::vector<int>);
+        void setInputSizes (std::vector<cv::Size>);
+        DnnProfile tune (const std::vector<cv::Mat> &, int = 10);
+        DnnProfile loadOrTune (std::string, std::function<std::vector<cv::Mat> ()>, bool = false);
+        static bool load (std::string, DnnProfile &);
+        static void save (std::string, const DnnProfile &);
+
+    protected:
+        double measure (YoloDetector &, const std::vector<cv::Mat> &, int);
+
+        ModelCache &model;
+        double budget_ms;
+        std::vector<std::pair<int,int>> backends;
+        std::vector<int> thread_counts;
+        std::vector<cv::Size> input_sizes;
+};
@@ -0,0 +1,157 @@
+#include "dualstreamframe.hpp"
+
+
+DualStreamFrame::DualStreamFrame () {
+    
+    scale_x = 1.0;
+    scale_y = 1.0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void DualStreamFrame::reset (const cv::Mat &lowResFrame, cv::Size fullFrameSize, const FrameMetadata &metadataIn, 
+    const cv::Mat &fullResFrame, const cv::Mat &encodedFrame) {
+
+    /**
+     * Start a new frame
+     * @param lowResFrame - the detection stream image
+     * @param fullFrameSize - size of the full resolution frame
+     * @param metadataIn - capture metadata
+     * @param fullResFrame - full resolution image if it already exists
+     * @param encodedFrame - compressed buffer to decode the full resolution image from
+    */
+
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    low_res = lowResFrame;
+    full_res = fullResFrame;
+    encoded = encodedFrame;
+    full_size = fullFrameSize;
+    frame_metadata = metadataIn;
+    scale_x = low_res.cols > 0 ? (double)full_size.width / low_res.cols : 1.0;
+    scale_y = low_res.rows > 0 ? (double)full_size.height / low_res.rows : 1.0;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat DualStreamFrame::lowRes () {
+    
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return low_res;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat& DualStreamFrame::fullResLocked () {
+    /**
+     * Produce the full resolution image if it doesn't exist yet. Decodes the 
+     * compressed buffer when there is one, otherwise upsizes the low resolution image.
+     * The frame mutex must be held.
+    */
+
+    if (full_res.empty()) {
+        if (!encoded.empty()) {
+            cv::imdecode(encoded, cv::IMREAD_COLOR, &full_res);
+        }
+        if (full_res.empty() && !low_res.empty()) {
+            spdlog::warn("No full resolution source for frame, upsizing the low resolution image");
+            cv::resize(low_res, full_res, full_size, 0, 0, cv::INTER_LINEAR);
+        }
+    }
+    return full_res;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat DualStreamFrame::fullRes () {
+    /**
+     * Get the full resolution frame. Costs a full decode the first time in reduced decode mode.
+    */
+
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return fullResLocked();
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat DualStreamFrame::crop (cv::Rect fullResRect) {
+    /**
+     * Get a full resolution region of the frame, e.g. for a confirmation pass on a small target
+     * @param fullResRect - region in full resolution coordinates, clipped to the frame
+     * @returns view into the full resolution frame, empty if the region is outside the frame
+    */
+
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    cv::Mat &full = fullResLocked();
+    cv::Rect clipped = fullResRect & cv::Rect(0, 0, full.cols, full.rows);
+    if (clipped.empty()) {
+        return cv::Mat();
+    }
+    return full(clipped);
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size DualStreamFrame::fullSize () {
+    
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return full_size;
+}
+
+// --------------------------------------------------------------------------------------
+
+FrameMetadata DualStreamFrame::metadata () {
+    
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return frame_metadata;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect DualStreamFrame::toFullRes (cv::Rect lowResRect) {
+    /**
+     * Map a box found on the low resolution image to full resolution coordinates
+    */
+
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return cv::Rect(cvRound(lowResRect.x * scale_x), cvRound(lowResRect.y * scale_y), 
+        cvRound(lowResRect.width * scale_x), cvRound(lowResRect.height * scale_y));
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Point DualStreamFrame::toFullRes (cv::Point lowResPoint) {
+    
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return cv::Point(cvRound(lowResPoint.x * scale_x), cvRound(lowResPoint.y * scale_y));
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect DualStreamFrame::toLowRes (cv::Rect fullResRect) {
+    /**
+     * Map a full resolution box to low resolution coordinates, e.g. for drawing on the detection stream
+    */
+
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return cv::Rect(cvRound(fullResRect.x / scale_x), cvRound(fullResRect.y / scale_y), 
+        cvRound(fullResRect.width / scale_x), cvRound(fullResRect.height / scale_y));
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Point DualStreamFrame::toLowRes (cv::Point fullResPoint) {
+    
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return cv::Point(cvRound(fullResPoint.x / scale_x), cvRound(fullResPoint.y / scale_y));
+}
+
+// --------------------------------------------------------------------------------------
+
+bool DualStreamFrame::fullResDecoded () {
+    /**
+     * Returns true if the full resolution image exists, i.e. was supplied or already decoded
+    */
+
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return !full_res.empty();
+}
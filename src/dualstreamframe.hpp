@@ -0,0 +1,41 @@
+#pragma once
+
+#include <mutex>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "framemetadata.hpp"
+
+/**
+ * Two views of the same captured frame: a cheap low resolution image for detection
+ * and the full resolution image, produced only when a caller asks for it. When the
+ * camera delivers compressed frames the full image is decoded from the kept MJPG
+ * buffer on demand. Coordinates map both ways between the two resolutions.
+*/
+class DualStreamFrame {
+    public:
+        DualStreamFrame ();
+        void reset (const cv::Mat &, cv::Size, const FrameMetadata &, const cv::Mat & = cv::Mat(), const cv::Mat & = cv::Mat());
+        cv::Mat lowRes ();
+        cv::Mat fullRes ();
+        cv::Mat crop (cv::Rect);
+        cv::Size fullSize ();
+        FrameMetadata metadata ();
+        cv::Rect toFullRes (cv::Rect);
+        cv::Point toFullRes (cv::Point);
+        cv::Rect toLowRes (cv::Rect);
+        cv::Point toLowRes (cv::Point);
+        bool fullResDecoded ();
+
+    protected:
+        cv::Mat& fullResLocked ();
+
+        std::mutex frame_mutex;
+        cv::Mat low_res;
+        cv::Mat full_res;
+        cv::Mat encoded;
+        cv::Size full_size;
+        FrameMetadata frame_metadata;
+        double scale_x;
+        double scale_y;
+};
@@ -0,0 +1,275 @@
+#include "filecapturemanager.hpp"
+
+
+FileCaptureManager::FileCaptureManager (PacingMode pacingMode) {
+    
+    pacing = pacingMode;
+    image_index = 0;
+    fps = 30.0;
+    loop = false;
+    frames_delivered = 0;
+    last_timestamp = -1.0;
+    pacing_started = false;
+    first_timestamp = 0.0;
+    step_permits = 0;
+    closed = true;
+}
+
+// -------------------------------------------------------------------------
+
+FileCaptureManager::~FileCaptureManager () {
+    close();
+}
+
+// -------------------------------------------------------------------------
+
+int FileCaptureManager::open (std::string path) {
+    /**
+     * Open a video file or a directory of images
+     * @param path - video file or directory
+     * @returns 0, throws if the source could not be opened
+    */
+
+    // Opening again replaces the previous source
+    image_files.clear();
+    image_index = 0;
+    if (cap) {
+        CaptureManager::close();
+    }
+
+    if (std::filesystem::is_directory(path)) {
+        const std::vector<std::string> extensions = {".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".ppm", ".pgm"};
+
+        for (auto &entry : std::filesystem::directory_iterator(path)) {
+            std::string ext = entry.path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if (std::find(extensions.begin(), extensions.end(), ext) != extensions.end()) {
+                image_files.push_back(entry.path().string());
+            }
+        }
+        
+        if (image_files.empty()) {
+            throw ("No images found in directory");
+        }
+        std::sort(image_files.begin(), image_files.end());
+        image_index = 0;
+    }
+    else {
+        cap = new cv::VideoCapture(path, cv::CAP_ANY);
+        if (!cap->isOpened()) {
+            throw ("Unable to open video file");
+        }
+        
+        double file_fps = cap->get(cv::CAP_PROP_FPS);
+        if (file_fps > 0.0) {
+            fps = file_fps;
+        }
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock (step_mutex);
+        closed = false;
+    }
+    pacing_started = false;
+    frames_delivered = 0;
+    return 0;
+}
+
+// -------------------------------------------------------------------------
+
+bool FileCaptureManager::read (cv::OutputArray& frame) {
+    /**
+     * Read the next frame, paced according to the pacing mode
+     * @param frame - filled with the next frame
+     * @returns false at the end of the source (unless looping) or when closed
+    */
+
+    if (pacing == PacingMode::STEPPED) {
+        std::unique_lock<std::mutex> lock (step_mutex);
+        step_cond.wait(lock, [this] { return step_permits > 0 || closed; });
+        if (closed) {
+            return false;
+        }
+        step_permits--;
+    }
+    
+    cv::Mat next;
+    double timestamp;
+    if (!readNext(next, timestamp)) {
+        if (!loop || !rewind() || !readNext(next, timestamp)) {
+            return false;
+        }
+    }
+
+    if (pacing == PacingMode::REALTIME) {
+        pace(timestamp);
+    }
+
+    frame.assign(next);
+    frames_delivered++;
+    last_timestamp = timestamp;
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+bool FileCaptureManager::read (cv::OutputArray& frame, FrameMetadata& metadata) {
+    /**
+     * Read the next frame, using the file position as the driver timestamp
+    */
+
+    if (!CaptureManager::read(frame, metadata)) {
+        return false;
+    }
+    metadata.driver_timestamp = last_timestamp;
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+bool FileCaptureManager::readNext (cv::Mat &frame, double &timestamp) {
+    /**
+     * Decode the next frame from the video or image list
+     * @param frame - decoded frame
+     * @param timestamp - position of the frame in milliseconds 
+     * @returns false at the end of the source
+    */
+
+    if (cap) {
+        if (!cap->read(frame)) {
+            return false;
+        }
+        timestamp = cap->get(cv::CAP_PROP_POS_MSEC);
+        
+        // Not every backend reports a position, fall back to the frame index
+        if (timestamp <= 0.0) {
+            timestamp = (cap->get(cv::CAP_PROP_POS_FRAMES) - 1) * 1000.0 / fps;
+        }
+        return true;
+    }
+
+    // Skip any files which fail to decode
+    while (image_index < image_files.size()) {
+        timestamp = image_index * 1000.0 / fps;
+        frame = cv::imread(image_files[image_index++], cv::IMREAD_COLOR);
+        if (!frame.empty()) {
+            return true;
+        }
+        spdlog::warn("Unable to decode: " + image_files[image_index - 1]);
+    }
+    
+    return false;
+}
+
+// -------------------------------------------------------------------------
+
+bool FileCaptureManager::rewind () {
+    /**
+     * Go back to the first frame and restart pacing
+     * @returns true if successful
+    */
+
+    pacing_started = false;
+    if (cap) {
+        return cap->set(cv::CAP_PROP_POS_FRAMES, 0);
+    }
+    image_index = 0;
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+void FileCaptureManager::pace (double timestamp) {
+    /**
+     * Sleep until the frame is due, measured from the first frame delivered. 
+     * A reader which falls behind is not made to sleep.
+     * @param timestamp - position of the frame in milliseconds
+    */
+
+    auto now = std::chrono::steady_clock::now();
+    if (!pacing_started) {
+        pacing_started = true;
+        start_time = now;
+        first_timestamp = timestamp;
+        return;
+    }
+
+    auto due = start_time + std::chrono::microseconds((long long)((timestamp - first_timestamp) * 1000.0));
+    if (due > now) {
+        std::this_thread::sleep_until(due);
+    }
+}
+
+// -------------------------------------------------------------------------
+
+void FileCaptureManager::step (int frames) {
+    /**
+     * Allow the given number of frames to be read in STEPPED mode
+     * @param frames - number of frames to release
+    */
+
+    {
+        const std::lock_guard<std::mutex> lock (step_mutex);
+        step_permits += frames;
+    }
+    step_cond.notify_all();
+}
+
+// -------------------------------------------------------------------------
+
+void FileCaptureManager::close () {
+    /**
+     * Release the source and wake any reader waiting for a step
+    */
+
+    {
+        const std::lock_guard<std::mutex> lock (step_mutex);
+        closed = true;
+    }
+    step_cond.notify_all();
+    
+    image_files.clear();
+    image_index = 0;
+    if (cap) {
+        CaptureManager::close();
+    }
+}
+
+// -------------------------------------------------------------------------
+
+void FileCaptureManager::setPacing (PacingMode pacingMode) {
+    
+    pacing = pacingMode;
+    pacing_started = false;
+}
+
+// -------------------------------------------------------------------------
+
+void FileCaptureManager::setFps (double framesPerSecond) {
+    /**
+     * Set the rate used for image directories, or for videos which report no rate
+    */
+
+    fps = framesPerSecond;
+}
+
+// -------------------------------------------------------------------------
+
+void FileCaptureManager::setLoop (bool loopSource) {
+    
+    loop = loopSource;
+}
+
+// -------------------------------------------------------------------------
+
+double FileCaptureManager::getFps () {
+    
+    return fps;
+}
+
+// -------------------------------------------------------------------------
+
+long FileCaptureManager::getFramesDelivered () {
+    
+    return frames_delivered;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include "capturemanager.hpp"
+
+/**
+ * How a file source paces its frames.
+ * REALTIME - deliver frames at the rate given by their timestamps
+ * MAX_SPEED - deliver frames as fast as they can be decoded
+ * STEPPED - deliver a frame only when step() allows it
+*/
+enum class PacingMode {REALTIME, MAX_SPEED, STEPPED};
+
+/**
+ * Capture manager which streams a video file or a directory of images through 
+ * the same read() interface as a camera. Used for benchmarking and testing the
+ * pipeline without a camera attached.
+*/
+class FileCaptureManager: public CaptureManager {
+    public:
+        FileCaptureManager (PacingMode = PacingMode::REALTIME);
+        ~FileCaptureManager (void);
+        using CaptureManager::open;
+        int open (std::string);
+        bool read (cv::OutputArray&);
+        bool read (cv::OutputArray&, FrameMetadata&);
+        void close (void);
+        void step (int = 1);
+        void setPacing (PacingMode);
+        void setFps (double);
+        void setLoop (bool);
+        double getFps ();
+        long getFramesDelivered ();
+
+    protected:
+        bool readNext (cv::Mat &, double &);
+        bool rewind ();
+        void pace (double);
+
+        std::vector<std::string> image_files;
+        size_t image_index;
+        PacingMode pacing;
+        double fps;
+        bool loop;
+        long frames_delivered;
+        double last_timestamp;
+        bool pacing_started;
+        double first_timestamp;
+        std::chrono::steady_clock::time_point start_time;
+        
+        std::mutex step_mutex;
+        std::condition_variable step_cond;
+        long step_permits;
+        bool closed;
+};
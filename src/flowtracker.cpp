@@ -0,0 +1,244 @@
+#include "flowtracker.hpp"
+
+
+FlowTracker::FlowTracker (int maxPoints, cv::Size windowSize, int pyramidLevels) {
+    /**
+     * @param maxPoints - most keypoints followed inside the box
+     * @param windowSize - Lucas-Kanade search window at each pyramid level
+     * @param pyramidLevels - pyramid levels above the full image
+    */
+
+    max_points = maxPoints;
+    window = windowSize;
+    levels = pyramidLevels;
+    fb_threshold = 1.0;
+    min_points = 6;
+    reset();
+}
+
+// --------------------------------------------------------------------------------------
+
+void FlowTracker::init (const cv::Mat &gray, cv::Rect startBox) {
+    /**
+     * Start tracking a box, normally one just found by the detector
+     * @param gray - 8 bit grayscale frame
+     * @param startBox - box in frame coordinates
+    */
+
+    box = cv::Rect2f(startBox) & cv::Rect2f(0, 0, (float)gray.cols, (float)gray.rows);
+    // Callers reuse their gray buffer for the next frame, so a shared header would 
+    // turn into that frame and the flow would compare a frame with itself
+    gray.copyTo(previous);
+    seedPoints(gray);
+    seeded = points.size();
+    confidence = 1.0;
+    tracking = points.size() >= min_points;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool FlowTracker::update (const cv::Mat &gray, cv::Rect &trackedBox) {
+    /**
+     * Follow the box into the next frame
+     * @param gray - 8 bit grayscale frame, the same size as the one tracking started on
+     * @param trackedBox - receives the box in frame coordinates
+     * @returns false once too few points survive, which ends tracking
+    */
+
+    if (!tracking) {
+        return false;
+    }
+
+    cv::calcOpticalFlowPyrLK(previous, gray, points, next_points, status, errors, window, levels);
+    cv::calcOpticalFlowPyrLK(gray, previous, next_points, back_points, back_status, errors, window, levels);
+
+    // Keep points which flow back to within the threshold of where they started
+    std::vector<float> dx, dy;
+    std::vector<cv::Point2f> kept;
+    for (size_t i=0; i<points.size(); i++) {
+        if (!status[i] || !back_status[i]) {
+            continue;
+        }
+        cv::Point2f fb = back_points[i] - points[i];
+        if (fb.x * fb.x + fb.y * fb.y > fb_threshold * fb_threshold) {
+            continue;
+        }
+        dx.push_back(next_points[i].x - points[i].x);
+        dy.push_back(next_points[i].y - points[i].y);
+        kept.push_back(next_points[i]);
+    }
+
+    gray.copyTo(previous);
+    confidence = seeded > 0 ? (float)kept.size() / seeded : 0.0f;
+    if (kept.size() < min_points) {
+        tracking = false;
+        return false;
+    }
+
+    box.x += median(dx);
+    box.y += median(dy);
+    points = std::move(kept);
+    trackedBox = cv::Rect(box);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+void FlowTracker::reset () {
+
+    previous.release();
+    points.clear();
+    seeded = 0;
+    box = cv::Rect2f();
+    confidence = 0.0;
+    tracking = false;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool FlowTracker::isTracking () {
+
+    return tracking;
+}
+
+// --------------------------------------------------------------------------------------
+
+float FlowTracker::getConfidence () {
+    /**
+     * Fraction of the points seeded at the last init that are still being followed
+    */
+
+    return confidence;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect FlowTracker::getBox () {
+
+    return cv::Rect(box);
+}
+
+// --------------------------------------------------------------------------------------
+
+void FlowTracker::setForwardBackwardThreshold (float pixels) {
+    /**
+     * @param pixels - furthest a point may land from its start after tracking there and back
+    */
+
+    fb_threshold = pixels;
+}
+
+// --------------------------------------------------------------------------------------
+
+void FlowTracker::seedPoints (const cv::Mat &gray) {
+    /**
+     * Pick corners inside the box, or a regular grid when it has too little texture
+    */
+
+    points.clear();
+    cv::Rect roi = cv::Rect(box);
+    if (roi.empty()) {
+        return;
+    }
+
+    cv::goodFeaturesToTrack(gray(roi), points, max_points, 0.01, 3);
+    if (points.size() < min_points) {
+        points.clear();
+        int side = std::max((int)std::sqrt((double)max_points), 2);
+        for (int row=0; row<side; row++) {
+            for (int col=0; col<side; col++) {
+                points.push_back(cv::Point2f(roi.width * (col + 0.5f) / side, roi.height * (row + 0.5f) / side));
+            }
+        }
+    }
+
+    for (auto &point : points) {
+        point += cv::Point2f((float)roi.x, (float)roi.y);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+float FlowTracker::median (std::vector<float> &values) {
+
+    auto middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+}
+
+// ======================================================================================
+
+DetectionCadence::DetectionCadence (int minInterval, int maxInterval, float healthyConfidence, float weakConfidence) {
+    /**
+     * @param minInterval - fewest frames between detections, 1 to detect every frame
+     * @param maxInterval - most frames between detections while the tracker is healthy
+     * @param healthyConfidence - tracker confidence needed to lengthen the interval
+     * @param weakConfidence - tracker confidence below which a detection is forced
+    */
+
+    min_interval = std::max(minInterval, 1);
+    max_interval = std::max(maxInterval, min_interval);
+    healthy_confidence = healthyConfidence;
+    weak_confidence = weakConfidence;
+    interval = min_interval;
+    since_detection = 0;
+    force = true;
+    healthy = false;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool DetectionCadence::detectNow () {
+    /**
+     * Call once per frame
+     * @returns true if this frame should get a full detection
+    */
+
+    return force || ++since_detection >= interval;
+}
+
+// --------------------------------------------------------------------------------------
+
+void DetectionCadence::detected (bool found) {
+    /**
+     * Report a full detection
+     * @param found - whether the target was found, which is the only way tracking can restart
+    */
+
+    if (!found) {
+        interval = min_interval;
+    }
+    else if (healthy) {
+        interval = std::min(interval + 1, max_interval);
+    }
+
+    since_detection = 0;
+    force = !found;
+    healthy = found;
+}
+
+// --------------------------------------------------------------------------------------
+
+void DetectionCadence::tracked (bool ok, float confidence) {
+    /**
+     * Report a tracker update between detections
+     * @param ok - false if the tracker lost the target
+     * @param confidence - the tracker's confidence after the update
+    */
+
+    if (!ok || confidence < weak_confidence) {
+        interval = std::max(interval / 2, min_interval);
+        force = true;
+        healthy = false;
+    }
+    else if (confidence < healthy_confidence) {
+        healthy = false;
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+int DetectionCadence::getInterval () {
+
+    return interval;
+}
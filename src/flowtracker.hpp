@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * Cheap frame to frame tracker for one box. Keypoints inside the box are followed
+ * with pyramidal Lucas-Kanade optical flow, and each point is tracked back again
+ * to check it returns to where it started. The box moves by the median motion of the
+ * points that pass, and the fraction that pass is the tracker's confidence.
+*/
+class FlowTracker {
+    public:
+        FlowTracker (int = 40, cv::Size = cv::Size(21, 21), int = 3);
+        void init (const cv::Mat &, cv::Rect);
+        bool update (const cv::Mat &, cv::Rect &);
+        void reset ();
+        bool isTracking ();
+        float getConfidence ();
+        cv::Rect getBox ();
+        void setForwardBackwardThreshold (float);
+
+    protected:
+        void seedPoints (const cv::Mat &);
+        static float median (std::vector<float> &);
+
+        int max_points;
+        cv::Size window;
+        int levels;
+        float fb_threshold;
+        size_t min_points;
+
+        cv::Mat previous;
+        std::vector<cv::Point2f> points;
+        std::vector<cv::Point2f> next_points;
+        std::vector<cv::Point2f> back_points;
+        std::vector<uchar> status;
+        std::vector<uchar> back_status;
+        std::vector<float> errors;
+        size_t seeded;
+        cv::Rect2f box;
+        float confidence;
+        bool tracking;
+};
+
+/**
+ * Decides which frames get a full detection when a tracker covers the ones in between.
+ * The interval grows by one frame for every detection made while the tracker
+ * stays healthy, and halves with an immediate detection when the tracker weakens.
+*/
+class DetectionCadence {
+    public:
+        DetectionCadence (int = 1, int = 10, float = 0.7, float = 0.4);
+        bool detectNow ();
+        void detected (bool);
+        void tracked (bool, float);
+        int getInterval ();
+
+    protected:
+        int min_interval;
+        int max_interval;
+        float healthy_confidence;
+        float weak_confidence;
+        int interval;
+        int since_detection;
+        bool force;
+        bool healthy;
+};
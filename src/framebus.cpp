@@ -0,0 +1,356 @@
+#include "framebus.hpp"
+
+
+FrameBusWriter::FrameBusWriter () {
+    
+    slot_count = 0;
+    header = nullptr;
+    published = 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameBusWriter::create (std::string name, uint32_t slots) {
+    /**
+     * Name the bus. The shared memory itself is created with the first frame.
+     * @param name - shared memory name, e.g. "/frame-bus"
+     * @param slots - number of frames in the ring. More slots give slow readers longer
+     *                to use a peeked frame before it is overwritten.
+    */
+
+    close();
+    bus_name = name;
+    slot_count = std::max(slots, (uint32_t)2);
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameBusWriter::allocate (const cv::Mat &frame) {
+    /**
+     * Create the shared memory sized for the given frame and write the header
+    */
+
+    uint64_t frame_bytes = frame.total() * frame.elemSize();
+    uint64_t slot_stride = (sizeof(FrameBusSlot) + frame_bytes + FRAME_BUS_ALIGNMENT - 1) / FRAME_BUS_ALIGNMENT * FRAME_BUS_ALIGNMENT;
+    memory.create(bus_name, FRAME_BUS_ALIGNMENT + slot_stride * slot_count);
+    std::memset(memory.data(), 0, FRAME_BUS_ALIGNMENT + slot_stride * slot_count);
+
+    header = new (memory.data()) FrameBusHeader;
+    header->version = FRAME_BUS_VERSION;
+    header->slot_count = slot_count;
+    header->rows = frame.rows;
+    header->cols = frame.cols;
+    header->type = frame.type();
+    header->frame_bytes = frame_bytes;
+    header->slot_stride = slot_stride;
+    header->published.store(0, std::memory_order_relaxed);
+    
+    for (uint32_t i=0; i<slot_count; i++) {
+        new (memory.data() + FRAME_BUS_ALIGNMENT + i * slot_stride) FrameBusSlot;
+    }
+
+    // Readers check the magic last, so it is only written once the layout is complete
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, FRAME_BUS_MAGIC, sizeof header->magic);
+    spdlog::info("Frame bus " + bus_name + " created with " + std::to_string(slot_count) + " slots");
+}
+
+// --------------------------------------------------------------------------------------
+
+bool FrameBusWriter::publish (const cv::Mat &frame, const FrameMetadata &metadata) {
+    /**
+     * Copy a frame into the next slot of the ring
+     * @param frame - frame to publish
+     * @param metadata - capture metadata published with the frame
+     * @returns false if the bus isn't named or the frame doesn't match the ring
+    */
+
+    if (bus_name.empty() || frame.empty()) {
+        return false;
+    }
+    if (!header) {
+        allocate(frame);
+    }
+    if (frame.rows != header->rows || frame.cols != header->cols || frame.type() != header->type) {
+        return false;
+    }
+
+    uint64_t number = published;
+    FrameBusSlot* slot = (FrameBusSlot*)(memory.data() + FRAME_BUS_ALIGNMENT + (number % slot_count) * header->slot_stride);
+    unsigned char* data = (unsigned char*)slot + sizeof(FrameBusSlot);
+    
+    // Mark the slot as being written before touching the data
+    slot->lock.store(2 * number + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (frame.isContinuous()) {
+        std::memcpy(data, frame.data, header->frame_bytes);
+    }
+    else {
+        size_t row_bytes = frame.cols * frame.elemSize();
+        for (int row=0; row<frame.rows; row++) {
+            std::memcpy(data + row * row_bytes, frame.ptr(row), row_bytes);
+        }
+    }
+    slot->sequence = metadata.sequence;
+    slot->grab_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(metadata.grab_time.time_since_epoch()).count();
+    slot->driver_timestamp = metadata.driver_timestamp;
+
+    slot->lock.store(2 * number + 2, std::memory_order_release);
+    published = number + 1;
+    header->published.store(published, std::memory_order_release);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameBusWriter::close () {
+    
+    memory.close();
+    header = nullptr;
+    published = 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t FrameBusWriter::getPublished () {
+    
+    return published;
+}
+
+// ======================================================================================
+
+FrameBusReader::FrameBusReader () {
+    
+    header = nullptr;
+    last_sequence = 0;
+    received = 0;
+    missed = 0;
+    torn = 0;
+    retries = 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameBusReader::open (std::string name) {
+    /**
+     * Attach to a frame bus. Fails until the writer has published its first frame.
+     * @param name - shared memory name used by the writer
+     * @throws runtime_error if the bus doesn't exist or isn't a frame bus
+    */
+
+    close();
+    memory.open(name, true);
+    
+    header = (const FrameBusHeader*)memory.data();
+    if (memory.size() < sizeof(FrameBusHeader) || std::memcmp(header->magic, FRAME_BUS_MAGIC, sizeof header->magic) != 0) {
+        close();
+        throw std::runtime_error("Not a frame bus: " + name);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (header->version != FRAME_BUS_VERSION || 
+        memory.size() < FRAME_BUS_ALIGNMENT + header->slot_stride * header->slot_count) {
+        close();
+        throw std::runtime_error("Unsupported frame bus: " + name);
+    }
+    
+    // Start from the newest frame rather than replaying the ring
+    last_sequence = header->published.load(std::memory_order_acquire);
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameBusReader::close () {
+    
+    memory.close();
+    header = nullptr;
+}
+
+// --------------------------------------------------------------------------------------
+
+FrameBusSlot* FrameBusReader::slot (uint64_t number) {
+    
+    return (FrameBusSlot*)(memory.data() + FRAME_BUS_ALIGNMENT + (number % header->slot_count) * header->slot_stride);
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameBusReader::fillMetadata (const FrameBusSlot *busSlot, FrameMetadata &metadata) {
+    
+    metadata.sequence = busSlot->sequence;
+    metadata.grab_time = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(busSlot->grab_time_ns));
+    metadata.driver_timestamp = busSlot->driver_timestamp;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool FrameBusReader::waitForNewer (double timeoutSeconds, uint64_t &published) {
+    /**
+     * Poll until the writer publishes a frame this reader hasn't seen. 
+     * Spins briefly, then yields, then sleeps to keep an idle reader cheap.
+     * @param timeoutSeconds - how long to wait
+     * @param published - set to the writer's published count
+     * @returns false on timeout
+    */
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((long long)(timeoutSeconds * 1000000));
+    for (int attempt=0; ; attempt++) {
+        published = header->published.load(std::memory_order_acquire);
+        if (published > last_sequence) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        if (attempt < 100) {
+            continue;
+        }
+        if (attempt < 1000) {
+            std::this_thread::yield();
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+bool FrameBusReader::read (cv::Mat &frame, FrameMetadata &metadata, double timeoutSeconds) {
+    /**
+     * Copy out the newest frame not read before
+     * @param frame - receives a copy of the frame, reused if already the right size
+     * @param metadata - receives the capture metadata
+     * @param timeoutSeconds - how long to wait for a new frame
+     * @returns false on timeout or if the bus isn't open
+    */
+
+    if (!header) {
+        return false;
+    }
+
+    uint64_t published;
+    while (waitForNewer(timeoutSeconds, published)) {
+        uint64_t number = published - 1;
+        FrameBusSlot* bus_slot = slot(number);
+        
+        // A slot still being written is a normal seqlock retry, not a torn copy
+        uint64_t before = bus_slot->lock.load(std::memory_order_acquire);
+        if (before != 2 * number + 2) {
+            retries++;
+            continue;
+        }
+
+        frame.create(header->rows, header->cols, header->type);
+        std::memcpy(frame.data, (unsigned char*)bus_slot + sizeof(FrameBusSlot), header->frame_bytes);
+        fillMetadata(bus_slot, metadata);
+
+        // If the writer touched the slot during the copy, the copy is torn
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (bus_slot->lock.load(std::memory_order_relaxed) != before) {
+            torn++;
+            continue;
+        }
+
+        missed += number - last_sequence;
+        last_sequence = published;
+        received++;
+        return true;
+    }
+    return false;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool FrameBusReader::peek (cv::Mat &frame, FrameMetadata &metadata, uint64_t &token, double timeoutSeconds) {
+    /**
+     * Get the newest frame not read before without copying it. The Mat points into 
+     * shared memory and is read only; when done with it, call isCurrent(token) to 
+     * confirm the writer didn't overwrite the slot while it was in use.
+     * @param frame - set to a header over the shared slot
+     * @param metadata - receives the capture metadata
+     * @param token - identifies the slot state for isCurrent()
+     * @param timeoutSeconds - how long to wait for a new frame
+     * @returns false on timeout or if the bus isn't open
+    */
+
+    if (!header) {
+        return false;
+    }
+
+    uint64_t published;
+    while (waitForNewer(timeoutSeconds, published)) {
+        uint64_t number = published - 1;
+        FrameBusSlot* bus_slot = slot(number);
+        
+        token = bus_slot->lock.load(std::memory_order_acquire);
+        if (token != 2 * number + 2) {
+            retries++;
+            continue;
+        }
+
+        frame = cv::Mat(header->rows, header->cols, header->type, (unsigned char*)bus_slot + sizeof(FrameBusSlot));
+        fillMetadata(bus_slot, metadata);
+        
+        missed += number - last_sequence;
+        last_sequence = published;
+        received++;
+        return true;
+    }
+    return false;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool FrameBusReader::isCurrent (uint64_t token) {
+    /**
+     * Returns true if the slot behind a peeked frame still holds that frame
+    */
+
+    if (!header) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    
+    // The token encodes the frame number, and with it the slot
+    uint64_t number = token / 2 - 1;
+    return slot(number)->lock.load(std::memory_order_relaxed) == token;
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t FrameBusReader::getReceived () {
+    
+    return received;
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t FrameBusReader::getMissed () {
+    /**
+     * Frames published that this reader never saw because it fell behind
+    */
+
+    return missed;
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t FrameBusReader::getTorn () {
+    /**
+     * Copies discarded because the writer overwrote the slot during the copy
+    */
+
+    return torn;
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t FrameBusReader::getRetries () {
+    /**
+     * Reads retried because the newest slot was still being written
+    */
+
+    return retries;
+}
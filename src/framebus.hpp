@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "framemetadata.hpp"
+#include "mappedfile.hpp"
+
+/**
+ * Shared memory layout of a frame bus:
+ *   FrameBusHeader, padded to FRAME_BUS_ALIGNMENT
+ *   slot_count slots of slot_stride bytes, each a FrameBusSlot followed by the frame data
+ * 
+ * One writer, any number of readers, no locks. Each slot carries a sequence lock:
+ * the writer sets it odd while copying a frame in and to 2 * (frame number + 1) when 
+ * done. A reader checks the lock before and after using a slot; if it changed, the 
+ * writer lapped the reader and the frame is discarded.
+*/
+const char FRAME_BUS_MAGIC[8] = {'F', 'R', 'A', 'M', 'E', 'B', 'U', 'S'};
+const uint32_t FRAME_BUS_VERSION = 1;
+const uint64_t FRAME_BUS_ALIGNMENT = 4096;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Frame bus needs lock free 64 bit atomics");
+
+struct FrameBusHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint32_t reserved;
+    uint64_t frame_bytes;
+    uint64_t slot_stride;
+    std::atomic<uint64_t> published;
+};
+
+struct FrameBusSlot {
+    std::atomic<uint64_t> lock;
+    uint64_t sequence;
+    int64_t grab_time_ns;
+    double driver_timestamp;
+};
+
+/**
+ * Publishes frames into a named shared memory ring. The ring is created on the first
+ * frame, sized for that frame; frames of a different size or type are skipped.
+*/
+class FrameBusWriter {
+    public:
+        FrameBusWriter ();
+        void create (std::string, uint32_t = 4);
+        bool publish (const cv::Mat &, const FrameMetadata &);
+        void close ();
+        uint64_t getPublished ();
+    protected:
+        void allocate (const cv::Mat &);
+
+        SharedMemory memory;
+        std::string bus_name;
+        uint32_t slot_count;
+        FrameBusHeader* header;
+        uint64_t published;
+};
+
+/**
+ * Reads frames from a frame bus created by another process (or thread).
+ * read() copies the newest frame out; peek() returns a Mat header straight over the
+ * shared slot, which stays valid while isCurrent() returns true.
+*/
+class FrameBusReader {
+    public:
+        FrameBusReader ();
+        void open (std::string);
+        void close ();
+        bool read (cv::Mat &, FrameMetadata &, double = 1.0);
+        bool peek (cv::Mat &, FrameMetadata &, uint64_t &, double = 1.0);
+        bool isCurrent (uint64_t);
+        uint64_t getReceived ();
+        uint64_t getMissed ();
+        uint64_t getTorn ();
+        uint64_t getRetries ();
+    protected:
+        bool waitForNewer (double, uint64_t &);
+        FrameBusSlot* slot (uint64_t);
+        void fillMetadata (const FrameBusSlot *, FrameMetadata &);
+        
+        SharedMemory memory;
+        const FrameBusHeader* header;
+        uint64_t last_sequence;
+        uint64_t received;
+        uint64_t missed;
+        uint64_t torn;
+        uint64_t retries;
+};
@@ -0,0 +1,174 @@
+#include "framemetadata.hpp"
+
+
+double FrameMetadata::ageMilliseconds () const {
+    /**
+     * Milliseconds elapsed since the frame was grabbed
+    */
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - grab_time).count();
+}
+
+// ======================================================================================
+
+RollingStat::RollingStat (size_t windowSize) {
+    
+    window = windowSize;
+    sum = 0.0;
+    sum_squares = 0.0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void RollingStat::add (double value) {
+    /**
+     * Add a sample, dropping the oldest once the window is full
+    */
+
+    samples.push_back(value);
+    sum += value;
+    sum_squares += value * value;
+
+    if (samples.size() > window) {
+        double oldest = samples.front();
+        samples.pop_front();
+        sum -= oldest;
+        sum_squares -= oldest * oldest;
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void RollingStat::clear () {
+    
+    samples.clear();
+    sum = 0.0;
+    sum_squares = 0.0;
+}
+
+// --------------------------------------------------------------------------------------
+
+size_t RollingStat::count () {
+    
+    return samples.size();
+}
+
+// --------------------------------------------------------------------------------------
+
+double RollingStat::mean () {
+    
+    return samples.empty() ? 0.0 : sum / samples.size();
+}
+
+// --------------------------------------------------------------------------------------
+
+double RollingStat::stddev () {
+    
+    if (samples.size() < 2) {
+        return 0.0;
+    }
+    double m = mean();
+    // Guard against a tiny negative from floating point cancellation
+    return std::sqrt(std::max(0.0, sum_squares / samples.size() - m * m));
+}
+
+// --------------------------------------------------------------------------------------
+
+double RollingStat::max () {
+    
+    double max_value = 0.0;
+    for (double sample : samples) {
+        max_value = std::max(max_value, sample);
+    }
+    return max_value;
+}
+
+// --------------------------------------------------------------------------------------
+
+double RollingStat::last () {
+    
+    return samples.empty() ? 0.0 : samples.back();
+}
+
+// ======================================================================================
+
+FrameTimingMonitor::FrameTimingMonitor (size_t window, double stallFactor)
+    : intervals(window), latencies(window) {
+    
+    /**
+     * @param window - number of frames the rolling statistics cover
+     * @param stallFactor - a grab interval longer than this multiple of the mean is a camera stall
+    */
+
+    have_previous = false;
+    stall_factor = stallFactor;
+    frames = 0;
+    pipeline_dropped = 0;
+    camera_stalls = 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameTimingMonitor::update (const FrameMetadata &metadata) {
+    /**
+     * Account for a received frame. The interval between two received frames is divided
+     * by the number of sequence numbers between them, giving the camera's own grab 
+     * interval even when the pipeline is dropping frames.
+     * @param metadata - metadata of the received frame
+    */
+
+    frames++;
+    latencies.add(metadata.ageMilliseconds());
+
+    if (have_previous && metadata.sequence > previous.sequence) {
+        uint64_t sequence_delta = metadata.sequence - previous.sequence;
+        pipeline_dropped += sequence_delta - 1;
+
+        // Prefer the driver's clock when both frames have one
+        double elapsed;
+        if (metadata.driver_timestamp > 0.0 && previous.driver_timestamp > 0.0) {
+            elapsed = metadata.driver_timestamp - previous.driver_timestamp;
+        }
+        else {
+            elapsed = std::chrono::duration<double, std::milli>(metadata.grab_time - previous.grab_time).count();
+        }
+
+        double interval = elapsed / sequence_delta;
+        if (intervals.count() > 0 && interval > intervals.mean() * stall_factor) {
+            camera_stalls++;
+        }
+        intervals.add(interval);
+    }
+
+    previous = metadata;
+    have_previous = true;
+}
+
+// --------------------------------------------------------------------------------------
+
+FrameTimingStats FrameTimingMonitor::getStats () {
+    
+    FrameTimingStats stats;
+    stats.frames = frames;
+    stats.pipeline_dropped = pipeline_dropped;
+    stats.camera_stalls = camera_stalls;
+    stats.mean_interval_ms = intervals.mean();
+    stats.jitter_ms = intervals.stddev();
+    stats.max_interval_ms = intervals.max();
+    stats.mean_latency_ms = latencies.mean();
+    stats.max_latency_ms = latencies.max();
+    return stats;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string FrameTimingMonitor::printStats () {
+    
+    FrameTimingStats s = getStats();
+    std::ostringstream oss;
+    oss << "frames: " << s.frames << ", pipeline dropped: " << s.pipeline_dropped 
+        << ", camera stalls: " << s.camera_stalls << ", interval: " << s.mean_interval_ms 
+        << "ms (jitter " << s.jitter_ms << "ms, max " << s.max_interval_ms << "ms)" 
+        << ", latency: " << s.mean_latency_ms << "ms (max " << s.max_latency_ms << "ms)";
+    return oss.str();
+}
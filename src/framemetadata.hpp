@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <sstream>
+#include <string>
+
+/**
+ * Per frame capture information which travels with the frame through the pipeline.
+ * sequence - incremented for every frame grabbed from the source, so gaps seen by a 
+ *            consumer are frames the pipeline dropped
+ * grab_time - monotonic time the frame was returned by the driver
+ * driver_timestamp - source timestamp in milliseconds (CAP_PROP_POS_MSEC), negative if unavailable
+*/
+struct FrameMetadata {
+    uint64_t sequence = 0;
+    std::chrono::steady_clock::time_point grab_time;
+    double driver_timestamp = -1.0;
+
+    double ageMilliseconds () const;
+};
+
+/**
+ * Mean, standard deviation and maximum over the last N samples
+*/
+class RollingStat {
+    public:
+        RollingStat (size_t = 120);
+        void add (double);
+        void clear ();
+        size_t count ();
+        double mean ();
+        double stddev ();
+        double max ();
+        double last ();
+    protected:
+        std::deque<double> samples;
+        size_t window;
+        double sum;
+        double sum_squares;
+};
+
+/**
+ * Snapshot of the capture timing seen by a consumer.
+ * Camera stalls are grabs which arrived late; pipeline drops are sequence numbers
+ * the consumer never saw because it was too slow.
+*/
+struct FrameTimingStats {
+    uint64_t frames = 0;
+    uint64_t pipeline_dropped = 0;
+    uint64_t camera_stalls = 0;
+    double mean_interval_ms = 0.0;
+    double jitter_ms = 0.0;
+    double max_interval_ms = 0.0;
+    double mean_latency_ms = 0.0;
+    double max_latency_ms = 0.0;
+};
+
+/**
+ * Consumer side monitor of frame metadata. Call update() for every frame received.
+*/
+class FrameTimingMonitor {
+    public:
+        FrameTimingMonitor (size_t = 120, double = 1.5);
+        void update (const FrameMetadata &);
+        FrameTimingStats getStats ();
+        std::string printStats ();
+    protected:
+        RollingStat intervals;
+        RollingStat latencies;
+        FrameMetadata previous;
+        bool have_previous;
+        double stall_factor;
+        uint64_t frames;
+        uint64_t pipeline_dropped;
+        uint64_t camera_stalls;
+};
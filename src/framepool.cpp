@@ -0,0 +1,224 @@
+#include "framepool.hpp"
+
+
+HugePageAllocator* HugePageAllocator::instance () {
+    /**
+     * Allocators must outlive every Mat they allocated, so a single static instance is shared
+    */
+
+    static HugePageAllocator allocator;
+    return &allocator;
+}
+
+// -----------------------------------------------------------------------------------
+
+size_t HugePageAllocator::mappedLength (size_t size) {
+    /**
+     * Round a buffer size up to a whole number of 2MB huge pages
+    */
+
+    const size_t huge_page = 2 * 1024 * 1024;
+    return (size + huge_page - 1) / huge_page * huge_page;
+}
+
+// -----------------------------------------------------------------------------------
+
+cv::UMatData* HugePageAllocator::allocate (int dims, const int* sizes, int type, void* data0, 
+    size_t* step, cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const {
+
+    /**
+     * Compute the steps and total size the same way the standard OpenCV allocator does,
+     * then map the buffer
+    */
+
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i=dims-1; i>=0; i--) {
+        if (step) {
+            if (data0 && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uchar* data = (uchar*)data0;
+    if (!data) {
+#ifdef _WIN32
+        data = (uchar*)cv::fastMalloc(total);
+#else
+        size_t length = mappedLength(total);
+        void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED) {
+            // No reserved huge pages, ask for transparent huge pages instead
+            ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                CV_Error(cv::Error::StsNoMem, "Failed to map frame buffer");
+            }
+            madvise(ptr, length, MADV_HUGEPAGE);
+        }
+        data = (uchar*)ptr;
+#endif
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0) {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+    return u;
+}
+
+// -----------------------------------------------------------------------------------
+
+bool HugePageAllocator::allocate (cv::UMatData* u, cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const {
+    
+    return u != nullptr;
+}
+
+// -----------------------------------------------------------------------------------
+
+void HugePageAllocator::deallocate (cv::UMatData* u) const {
+    
+    if (!u) {
+        return;
+    }
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+#ifdef _WIN32
+        cv::fastFree(u->origdata);
+#else
+        munmap(u->origdata, mappedLength(u->size));
+#endif
+        u->origdata = nullptr;
+    }
+    delete u;
+}
+
+// ===================================================================================
+
+FramePool::FramePool (size_t count, cv::Size frameSize, int frameType, bool hugePages) {
+    /**
+     * Preallocate the pool buffers
+     * @param count - number of buffers. Must cover every stage that can hold a frame at once
+     * @param frameSize - size of each frame
+     * @param frameType - OpenCV type of each frame
+     * @param hugePages - back the buffers with huge pages where possible
+    */
+
+    frame_size = frameSize;
+    frame_type = frameType;
+    next_index = 0;
+
+    for (size_t i=0; i<count; i++) {
+        cv::Mat buffer;
+        if (hugePages) {
+            buffer.allocator = HugePageAllocator::instance();
+        }
+        buffer.create(frame_size, frame_type);
+        buffers.push_back(buffer);
+    }
+}
+
+// -----------------------------------------------------------------------------------
+
+cv::Mat FramePool::acquire () {
+    /**
+     * Get a buffer which no other stage references. The pool's own Mat holds the only 
+     * reference to a free buffer, so a refcount of 1 means it can be handed out.
+     * @returns a pooled buffer, or a newly allocated one if the pool is exhausted
+    */
+
+    const std::lock_guard<std::mutex> lock (pool_mutex);
+    stats.acquired++;
+
+    size_t in_use = 0;
+    cv::Mat found;
+    for (size_t i=0; i<buffers.size(); i++) {
+        size_t index = (next_index + i) % buffers.size();
+        if (buffers[index].u->refcount > 1) {
+            in_use++;
+        }
+        else if (found.empty()) {
+            found = buffers[index];
+            next_index = (index + 1) % buffers.size();
+        }
+    }
+
+    if (found.empty()) {
+        if (stats.exhausted++ == 0) {
+            spdlog::warn("Frame pool exhausted, falling back to heap allocation");
+        }
+        stats.in_use = buffers.size();
+        stats.high_water = buffers.size();
+        return cv::Mat(frame_size, frame_type);
+    }
+
+    stats.in_use = in_use + 1;
+    stats.high_water = std::max(stats.high_water, stats.in_use);
+    return found;
+}
+
+// -----------------------------------------------------------------------------------
+
+size_t FramePool::capacity () {
+    
+    return buffers.size();
+}
+
+// -----------------------------------------------------------------------------------
+
+size_t FramePool::available () {
+    /**
+     * Count the buffers not referenced outside the pool
+    */
+
+    const std::lock_guard<std::mutex> lock (pool_mutex);
+    size_t count = 0;
+    for (auto &buffer : buffers) {
+        if (buffer.u->refcount == 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------------
+
+bool FramePool::owns (const cv::Mat &frame) {
+    /**
+     * Returns true if the frame's data lives in one of the pool buffers
+    */
+
+    for (auto &buffer : buffers) {
+        if (frame.u == buffer.u) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------------
+
+FramePoolStats FramePool::getStats () {
+
+    const std::lock_guard<std::mutex> lock (pool_mutex);
+    return stats;
+}
+
+// -----------------------------------------------------------------------------------
+
+std::string FramePool::printStats () {
+    
+    FramePoolStats s = getStats();
+    std::ostringstream oss;
+    oss << "acquired: " << s.acquired << ", exhausted: " << s.exhausted 
+        << ", in use: " << s.in_use << "/" << buffers.size() << ", high water: " << s.high_water;
+    return oss.str();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+#endif
+
+/**
+ * Counters for a frame pool. Exhausted counts the acquires which found every
+ * buffer in use and had to fall back to a heap allocation.
+*/
+struct FramePoolStats {
+    uint64_t acquired = 0;
+    uint64_t exhausted = 0;
+    size_t in_use = 0;
+    size_t high_water = 0;
+};
+
+/**
+ * Matrix allocator which backs buffers with huge pages when the OS allows it.
+ * Falls back to transparent huge page hints, then to regular pages. 
+ * On Windows the regular OpenCV allocation is used.
+*/
+class HugePageAllocator: public cv::MatAllocator {
+    public:
+        static HugePageAllocator* instance ();
+        cv::UMatData* allocate (int, const int*, int, void*, size_t*, cv::AccessFlag, cv::UMatUsageFlags) const override;
+        bool allocate (cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const override;
+        void deallocate (cv::UMatData*) const override;
+    protected:
+        static size_t mappedLength (size_t);
+};
+
+/**
+ * Fixed size pool of preallocated frame buffers. Buffers are reference counted
+ * cv::Mat's: acquire() hands out a buffer that nothing outside the pool references,
+ * and the buffer returns to the pool when the last stage holding it releases its Mat.
+*/
+class FramePool {
+    public:
+        FramePool (size_t, cv::Size, int = CV_8UC3, bool = false);
+        cv::Mat acquire ();
+        size_t capacity ();
+        size_t available ();
+        bool owns (const cv::Mat &);
+        FramePoolStats getStats ();
+        std::string printStats ();
+    protected:
+        std::vector<cv::Mat> buffers;
+        std::mutex pool_mutex;
+        FramePoolStats stats;
+        cv::Size frame_size;
+        int frame_type;
+        size_t next_index;
+};
@@ -0,0 +1,252 @@
+#include "frameproducts.hpp"
+
+
+FrameProducts::FrameProducts () {
+    
+    computed = 0;
+    reused = 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameProducts::invalidate (FrameProduct &product) {
+    /**
+     * Mark a product from the previous frame as stale. A buffer still referenced 
+     * by a consumer is released so the consumer's copy is never written over;
+     * otherwise it is kept and reused for the next frame.
+    */
+
+    product.valid = false;
+    if (product.image.u && product.image.u->refcount > 1) {
+        product.image.release();
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void FrameProducts::reset (const cv::Mat &frameIn, const FrameMetadata &metadataIn) {
+    /**
+     * Start a new frame, invalidating every cached product
+     * @param frameIn - the new frame, referenced not copied
+     * @param metadataIn - capture metadata of the frame
+    */
+
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    source = frameIn;
+    source_metadata = metadataIn;
+    
+    for (auto &product : levels) {
+        invalidate(product);
+    }
+    for (auto &product : grays) {
+        invalidate(product);
+    }
+    for (auto &[key, product] : resized_images) {
+        invalidate(product);
+    }
+    for (auto &[key, product] : blobs) {
+        invalidate(product);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat FrameProducts::frame () {
+    
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    return source;
+}
+
+// --------------------------------------------------------------------------------------
+
+FrameMetadata FrameProducts::metadata () {
+    
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    return source_metadata;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat& FrameProducts::levelLocked (int levelIndex) {
+    /**
+     * Get a pyramid level, computing it and any missing levels above it.
+     * Level 0 is the frame, each further level is half the size of the previous one.
+     * The products mutex must be held.
+    */
+
+    if (levelIndex <= 0) {
+        return source;
+    }
+    if ((int)levels.size() < levelIndex) {
+        levels.resize(levelIndex);
+    }
+    
+    FrameProduct &product = levels[levelIndex - 1];
+    if (product.valid) {
+        reused++;
+        return product.image;
+    }
+    
+    cv::Mat &previous = levelLocked(levelIndex - 1);
+    cv::resize(previous, product.image, cv::Size((previous.cols + 1) / 2, (previous.rows + 1) / 2), 0, 0, cv::INTER_AREA);
+    product.valid = true;
+    computed++;
+    return product.image;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat FrameProducts::level (int levelIndex) {
+    /**
+     * Get the frame at 1/2^levelIndex of its full size
+     * @param levelIndex - pyramid level, 0 for the full frame
+    */
+
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    return levelLocked(levelIndex);
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat FrameProducts::gray (int levelIndex) {
+    /**
+     * Get a grayscale version of a pyramid level
+     * @param levelIndex - pyramid level, 0 for the full frame
+    */
+
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    cv::Mat &color = levelLocked(levelIndex);
+    if (color.channels() == 1) {
+        return color;
+    }
+
+    levelIndex = std::max(levelIndex, 0);
+    if ((int)grays.size() <= levelIndex) {
+        grays.resize(levelIndex + 1);
+    }
+
+    FrameProduct &product = grays[levelIndex];
+    if (product.valid) {
+        reused++;
+        return product.image;
+    }
+    
+    cv::cvtColor(color, product.image, cv::COLOR_BGR2GRAY);
+    product.valid = true;
+    computed++;
+    return product.image;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat& FrameProducts::resizedLocked (cv::Size size) {
+    /**
+     * Get the frame resized to the given size. Starts from the smallest pyramid level 
+     * already computed that is still at least as large, so a cached level saves work.
+     * The products mutex must be held.
+    */
+
+    if (size == source.size()) {
+        return source;
+    }
+    
+    FrameProduct &product = resized_images[std::make_tuple(size.width, size.height)];
+    if (product.valid) {
+        reused++;
+        return product.image;
+    }
+    
+    cv::Mat *start = &source;
+    for (auto &candidate : levels) {
+        if (!candidate.valid || candidate.image.cols < size.width || candidate.image.rows < size.height) {
+            break;
+        }
+        start = &candidate.image;
+    }
+
+    cv::resize(*start, product.image, size, 0, 0, cv::INTER_LINEAR);
+    product.valid = true;
+    computed++;
+    return product.image;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat FrameProducts::resized (cv::Size size) {
+    /**
+     * Get the frame resized to the given size, e.g. the detector input size
+    */
+
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    return resizedLocked(size);
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat FrameProducts::blob (cv::Size size, double scale, bool swapRB) {
+    /**
+     * Get a detector input blob (NCHW float) for the frame
+     * @param size - network input size
+     * @param scale - multiplier applied to each pixel value
+     * @param swapRB - swap the red and blue channels
+    */
+
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    FrameProduct &product = blobs[std::make_tuple(size.width, size.height, scale, swapRB)];
+    if (product.valid) {
+        reused++;
+        return product.image;
+    }
+
+    // Built straight from the frame in one pass, unless the resized image is already there
+    auto resized = resized_images.find(std::make_tuple(size.width, size.height));
+    const cv::Mat &input = (resized != resized_images.end() && resized->second.valid) ? resized->second.image : source;
+    if (BlobKernel::supports(input)) {
+        blob_kernel.run(input, product.image, size, scale, swapRB);
+    }
+    else {
+        cv::dnn::blobFromImage(resizedLocked(size), product.image, scale, size, cv::Scalar(), swapRB, false);
+    }
+    product.valid = true;
+    computed++;
+    return product.image;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect FrameProducts::mapToFrame (cv::Rect rect, cv::Size from) {
+    /**
+     * Map a rectangle found on a derived image of the given size to frame coordinates
+     * @param rect - rectangle in derived image coordinates
+     * @param from - size of the derived image
+    */
+
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    double sx = (double)source.cols / from.width;
+    double sy = (double)source.rows / from.height;
+    return cv::Rect(cvRound(rect.x * sx), cvRound(rect.y * sy), cvRound(rect.width * sx), cvRound(rect.height * sy));
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Point FrameProducts::mapToFrame (cv::Point point, cv::Size from) {
+    
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    return cv::Point(cvRound(point.x * (double)source.cols / from.width), cvRound(point.y * (double)source.rows / from.height));
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t FrameProducts::getComputed () {
+    
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    return computed;
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t FrameProducts::getReused () {
+    
+    const std::lock_guard<std::mutex> lock (products_mutex);
+    return reused;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "blobkernel.hpp"
+#include "framemetadata.hpp"
+
+/**
+ * A cached derived image. The buffer outlives the frame it was computed for so 
+ * the next frame can reuse it.
+*/
+struct FrameProduct {
+    cv::Mat image;
+    bool valid = false;
+};
+
+/**
+ * A captured frame plus the images derived from it: half resolution pyramid levels,
+ * grayscale versions and detector sized images and blobs. Each product is computed
+ * the first time a consumer asks for it and shared by every later consumer of the 
+ * same frame. Safe to share between threads.
+*/
+class FrameProducts {
+    public:
+        FrameProducts ();
+        void reset (const cv::Mat &, const FrameMetadata & = FrameMetadata());
+        cv::Mat frame ();
+        FrameMetadata metadata ();
+        cv::Mat level (int);
+        cv::Mat gray (int = 0);
+        cv::Mat resized (cv::Size);
+        cv::Mat blob (cv::Size, double = 1.0/255, bool = false);
+        cv::Rect mapToFrame (cv::Rect, cv::Size);
+        cv::Point mapToFrame (cv::Point, cv::Size);
+        uint64_t getComputed ();
+        uint64_t getReused ();
+        
+    protected:
+        cv::Mat& levelLocked (int);
+        cv::Mat& resizedLocked (cv::Size);
+        static void invalidate (FrameProduct &);
+
+        std::mutex products_mutex;
+        cv::Mat source;
+        FrameMetadata source_metadata;
+        std::vector<FrameProduct> levels;
+        std::vector<FrameProduct> grays;
+        std::map<std::tuple<int,int>, FrameProduct> resized_images;
+        std::map<std::tuple<int,int,double,bool>, FrameProduct> blobs;
+        BlobKernel blob_kernel;
+        uint64_t computed;
+        uint64_t reused;
+};
@@ -3,22 +3,41 @@
 #include <json/json.h>
 #include<opencv2/opencv.hpp>//OpenCV header to use VideoCapture class//
 
-#include "cameracapturemanager.hpp"
+#include "threadedcapturemanager.hpp"
+#include "filecapturemanager.hpp"
+#include "rawframefile.hpp"
+#include "cascadedetector.hpp"
+#include "detector.hpp"
+#include "dnnautotuner.hpp"
+#include "modelcache.hpp"
+#include "motiongate.hpp"
+#include "yolodecoder.hpp"
+#include "pipeline.hpp"
+#include "proposaldetector.hpp"
+#include "resolutiongovernor.hpp"
+#include "roidetector.hpp"
+#include "tileddetector.hpp"
+#include "trackingdetector.hpp"
 //#include "usbservocontroller.hpp"
 //#include "pantilt.hpp"
 #include "pantilttracker.hpp"
 #include "servocalibration.hpp"
+#include "sorttracker.hpp"
 #include "serial.hpp"
 #include <thread>
+#include <memory>
+#include <filesystem>
 
 
 
 using namespace std;
 
-int main() {
+int main(int argc, char** argv) {
 
 
     try {
+        // Measures how long it takes to get from launch to the first displayed frame
+        utils::Timer startup_timer;
         cout << "threads: " << std::thread::hardware_concurrency() << endl;
         
         // Set up the logger
@@ -51,62 +70,292 @@ int main() {
             spdlog::info("Calibration Successful");
         }
     
-        CameraCaptureManager cm = CameraCaptureManager();
-        cm.open(0);
-        properties props = cm.getProperties();
-        cout << cm.printProperties(props) << endl;
-        cv::Mat frame;
-
-        cv::dnn::Net net = cv::dnn::readNetFromDarknet ("dnn_model/yolov4-tiny.cfg", "dnn_model/yolov4-tiny.weights");
-        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        // Detection runs on a low resolution stream, reduced by this factor from the 1600x896 capture
+        const int low_res_scale = 2;
         
-        cv::dnn::DetectionModel model = cv::dnn::DetectionModel(net);
-        model.setInputParams(1.0/255, cv::Size(320,320));
-        IntVec class_ids;
-        FloatVec confidences;
-        std::vector<cv::Rect> boxes;
-
-        //cv::Point center = cv::Point(1600 / 2, 896 / 2);
-        //cv::Point center = cv::Point(400, 300);
-        IntOffset correction;
-
-       
-        int skipFrames = 0;
+        // Preallocated buffers so frames cause no steady state heap allocation, sized to the pipeline
+        std::unique_ptr<FramePool> frame_pool;
         
-        while (cm.read(frame)) {
-
-            model.detect(frame, class_ids, confidences, boxes);
+        // A video file, image directory or raw frame file can be given in place of the camera, 
+        // optionally followed by "max" to run it as fast as possible. 
+        // "record <file>" records the camera to a raw frame file.
+        // "tune" retunes the DNN settings for this machine.
+        RawFrameRecorder recorder;
+        std::unique_ptr<CaptureManager> cm;
+        ThreadedCaptureManager* camera = nullptr;
+        bool record = argc > 2 && string(argv[1]) == "record";
+        bool tune = argc > 1 && string(argv[1]) == "tune";
+        if (argc > 1 && !record && !tune && std::filesystem::path(argv[1]).extension() == ".raw") {
+            auto raw_cm = std::make_unique<RawCaptureManager>();
+            raw_cm->open(argv[1]);
+            cm = std::move(raw_cm);
+        }
+        else if (argc > 1 && !record && !tune) {
+            PacingMode pacing = (argc > 2 && string(argv[2]) == "max") ? PacingMode::MAX_SPEED : PacingMode::REALTIME;
+            auto file_cm = std::make_unique<FileCaptureManager>(pacing);
+            file_cm->open(argv[1]);
+            cm = std::move(file_cm);
+        }
+        else {
+            // Frames are grabbed on a background thread so detection always runs on the newest one
+            auto camera_cm = std::make_unique<ThreadedCaptureManager>();
+            if (record) {
+                recorder.open(argv[2]);
+                camera_cm->setRecorder(&recorder);
+            }
+            
+            // Decode MJPG straight to the low resolution stream, full frames only on demand
+            camera_cm->setReducedDecode(low_res_scale);
+            camera_cm->open(0);
             
-            // Draw a rect for the best candidate where class_id == 0
-            for (size_t i=0; i<class_ids.size(); i++) {   
-                //cout << class_ids[i] << endl;     
-                if (class_ids[i] == 66) {
-                    auto center = boxes[i].tl() + cv::Point(boxes[i].width / 2, boxes[i].height /2);
-                    //cout << center << endl;
-                    if (true) {//(skipFrames == 0) {
-                        auto [seconds, frames_to_skip] = controller.correct(center);
-                        skipFrames = frames_to_skip; 
-                        cout << "seconds: " << seconds << ", skipframes: " << skipFrames << endl;         
-                    }
-                    else {
-                        skipFrames--;
-                    }
-
-                    cv::drawMarker(frame, center, cv::Scalar(255,0,0), cv::MARKER_CROSS, 200, 3);
-                    cv::rectangle(frame, boxes[i], cv::Scalar(255,0,0), 2, cv::LINE_8);
-                    break;
-                }         
+            properties props = camera_cm->getProperties();
+            cout << camera_cm->printProperties(props) << endl;
+            camera = camera_cm.get();
+            cm = std::move(camera_cm);
+        }
+        FrameTimingMonitor timing_monitor;
+        const int target_class = 66;
+
+        // Backend, thread count and input size come from the profile tuned for this machine,
+        // tuned on the first run here or when started with "tune"
+        // The model files stay mapped so each network is parsed from memory. Every network is
+        // still parsed and warmed up on its own, one per governed size, the cascade's second
+        // stage, the window detector and each tile worker, since a network shared between
+        // input sizes reallocates its layers at every switch, so startup pays for each
+        ModelCache model("dnn_model/yolov4-tiny.cfg", "dnn_model/yolov4-tiny.weights");
+        DnnAutoTuner tuner(model);
+        DnnProfile profile = tuner.loadOrTune("dnn_profile.json", [&] () {
+            std::vector<cv::Mat> samples;
+            DualStreamFrame sample;
+            while (samples.size() < 5 && cm->readDual(sample, low_res_scale)) {
+                samples.push_back(sample.lowRes().clone());
+            }
+            return samples;
+        }, tune);
+        profile.apply();
+
+        // Detection sits behind the Detector interface so the stages don't depend on the model.
+        // Only the target class is decoded from the network output.
+        // Each network is warmed up at its input size here, so the first frame isn't slow.
+        // Full frame detection starts at the tuned input size, then the governor moves between
+        // the sizes to keep inference within its budget as the load on the machine changes
+        const double inference_budget_ms = 50.0;
+        std::vector<cv::Size> input_sizes = {cv::Size(256, 256), cv::Size(320, 320), cv::Size(416, 416)};
+        if (std::find(input_sizes.begin(), input_sizes.end(), profile.input_size) == input_sizes.end()) {
+            input_sizes.push_back(profile.input_size);
+        }
+        std::sort(input_sizes.begin(), input_sizes.end(), [] (cv::Size a, cv::Size b) { return a.area() < b.area(); });
+        size_t start_index = std::find(input_sizes.begin(), input_sizes.end(), profile.input_size) - input_sizes.begin();
+        ResolutionGovernor governor(input_sizes, inference_budget_ms, start_index);
+        GovernedDetector detector(model, governor, profile.backend, profile.target);
+        detector.setClasses({target_class});
+
+        // The governed detector is the cheap first stage of a cascade. When its best target box
+        // is in the ambiguous confidence band, a larger input decides instead.
+        const bool cascade = true;
+        const float cascade_low = 0.3f, cascade_high = 0.5f;
+        cv::Size second_size = cv::Size(512, 512);
+        std::unique_ptr<YoloDetector> second_stage;
+        std::unique_ptr<CascadeDetector> cascade_detector;
+        if (cascade) {
+            detector.setThresholds(cascade_low, 0.0);
+            second_stage = std::make_unique<YoloDetector>(model.create(profile.backend, profile.target, second_size), second_size);
+            second_stage->setClasses({target_class});
+            cascade_detector = std::make_unique<CascadeDetector>(detector, *second_stage, target_class, cascade_low, cascade_high);
+        }
+        Detector &first_detector = cascade ? (Detector &)*cascade_detector : (Detector &)detector;
+
+        // Tiled search finds targets too small to survive the frame being squashed to the input,
+        // running overlapping tiles in parallel, each worker on its own network
+        const bool tiled_search = false;
+        const int tile_worker_count = 2;
+        std::vector<std::unique_ptr<YoloDetector>> tile_detectors;
+        std::vector<Detector *> tile_workers;
+        for (int i=0; tiled_search && i<tile_worker_count; i++) {
+            tile_detectors.push_back(std::make_unique<YoloDetector>(
+                model.create(profile.backend, profile.target, profile.input_size), profile.input_size));
+            tile_detectors.back()->setClasses({target_class});
+            tile_workers.push_back(tile_detectors.back().get());
+        }
+        std::unique_ptr<TiledDetector> tiled_detector;
+        if (tiled_search) {
+            tiled_detector = std::make_unique<TiledDetector>(tile_workers, TileLayout{3, 2, 0.25f});
+        }
+        Detector &full_detector = tiled_search ? (Detector &)*tiled_detector : first_detector;
+
+        // Once the target is found, detection runs on a window around it with a smaller input,
+        // following our own pan/tilt moves, until it's missed a few times in a row
+        const bool roi_search = true;
+        int window_input = (profile.input_size.width / 2 + 31) / 32 * 32;
+        cv::Size window_size = cv::Size(window_input, window_input);
+        YoloDetector window_detector(model.create(profile.backend, profile.target, window_size), window_size);
+        window_detector.setClasses({target_class});
+
+        // With no target, only the regions moving against the background are detected on,
+        // using the window detector's smaller input, with a full frame search every few seconds
+        // and while the servos move
+        const bool proposal_search = true;
+        ProposalDetector proposal_detector(full_detector, window_detector, 3.0);
+        proposal_detector.setServoActivity([&] (auto grabTime) { return controller.isMoving(grabTime); });
+        // Frames with several moving regions pack them into one canvas for the first stage
+        MosaicPacker mosaic_packer(first_detector);
+        proposal_detector.setPacker(&mosaic_packer);
+        Detector &frame_detector = proposal_search ? (Detector &)proposal_detector : full_detector;
+
+        // The servos' own moves shift the image, in low resolution pixels
+        CameraMotion camera_motion = [&] (auto from, auto to) {
+            return controller.imageShift(from, to) / low_res_scale;
+        };
+        RoiDetector roi_detector(frame_detector, window_detector, target_class);
+        roi_detector.setCameraMotion(camera_motion);
+        Detector &search_detector = roi_search ? (Detector &)roi_detector : frame_detector;
+
+        // Full detection runs at most every max_detect_interval frames, with optical flow 
+        // following the target in between. 1 detects every frame.
+        const int max_detect_interval = 10;
+        TrackingDetector tracking_detector(search_detector, target_class, DetectionCadence(1, max_detect_interval));
+
+        // Capture, preprocessing, inference and control each run on their own thread,
+        // so latency is set by the slowest stage rather than the sum of all of them
+        Pipeline pipeline;
+        pipeline.setSource("capture", [&] (PipelineFrame &item) {
+            if (!cm->readDual(*item.dual, low_res_scale)) {
+                return false;
+            }
+            item.metadata = item.dual->metadata();
+            timing_monitor.update(item.metadata);
+            return true;
+        });
+
+        // Frames of a static scene with idle servos skip detection and keep the last result,
+        // compared on the quarter size gray level. Detection is forced every couple of seconds.
+        MotionGate motion_gate(2.0);
+        motion_gate.setServoActivity([&] (auto grabTime) { return controller.isMoving(grabTime); });
+
+        // No blob is built here: flow, window and proposal frames never use the full frame one,
+        // so whichever detector runs builds its own input from the products
+        pipeline.addStage("preprocess", [&] (PipelineFrame &item) {
+            item.products->reset(item.dual->lowRes(), item.metadata);
+            if (proposal_search) {
+                proposal_detector.learn(*item.products);
+            }
+            item.detect = motion_gate.check(item.products->gray(2), item.metadata.grab_time);
+            return true;
+        });
+
+        // Detections become tracks with stable ids, and the aim stays on one locked track
+        // until it's lost rather than jumping to whichever candidate is most confident.
+        // Tracks survive the frames between full detections and follow the camera's own moves,
+        // but only the ones matched on the last detection are reported or aimed at.
+        SortTracker sort_tracker(target_class, max_detect_interval + 2);
+        sort_tracker.setCameraMotion(camera_motion);
+
+        // Detect on the low resolution stream and match the boxes to tracks, then map them
+        // back to full resolution
+        Detections detected;
+        pipeline.addStage("infer", [&] (PipelineFrame &item) {
+            auto grab_time = item.metadata.grab_time;
+            if (!item.detect) {
+                item.target = sort_tracker.predict(grab_time, item.detections, item.track_ids);
+            }
+            else {
+                tracking_detector.detect(*item.products, detected);
+                if (tracking_detector.wasTracked()) {
+                    roi_detector.follow(detected.boxes[0], grab_time);
+                }
+                item.target = sort_tracker.update(detected, grab_time, item.detections, item.track_ids);
+                // The flow tracker and ROI window start on the most confident box, so move
+                // them to the locked track, or it would only be seen on full detections
+                if (item.target >= 0 && !tracking_detector.wasTracked()) {
+                    cv::Rect locked = item.detections.boxes[item.target];
+                    tracking_detector.follow(*item.products, locked);
+                    roi_detector.follow(locked, grab_time);
+                }
+            }
+            for (auto &box : item.detections.boxes) {
+                box = item.dual->toFullRes(box);
+            }
+            return true;
+        });
+
+        // Every detection result is acted on, so inference waits for control rather than dropping
+        pipeline.addStage("control", [&] (PipelineFrame &item) {
+            // A repeated result was already acted on
+            if (item.target >= 0 && item.detect) {
+                cv::Rect box = item.detections.boxes[item.target];
+                item.target_center = box.tl() + cv::Point(box.width / 2, box.height / 2);
+                auto [seconds, frames_to_skip] = controller.correct(item.target_center, item.metadata);
+                cout << "seconds: " << seconds << ", skipframes: " << frames_to_skip << endl;
+            }
+            return true;
+        }, 2, QueuePolicy::BLOCK);
+
+        // Every pipeline item holds a frame, plus the grab thread's latest frame, the one it's
+        // decoding into and the one it's replacing
+        if (camera) {
+            int scale = camera->getDecodeScale();
+            frame_pool = std::make_unique<FramePool>(pipeline.getItemCount() + 3, 
+                cv::Size((1600 + scale - 1) / scale, (896 + scale - 1) / scale), CV_8UC3, true);
+            camera->setFramePool(frame_pool.get());
+        }
+
+        spdlog::info("Model ready: " + model.printStats());
+        pipeline.start();
+
+        // The display stays on the main thread, showing the low resolution stream
+        PipelineItem item;
+        bool first_frame = true;
+        while (!pipeline.finished()) {
+            if (!pipeline.pop(item)) {
+                continue;
+            }
+            if (first_frame) {
+                spdlog::info("First frame displayed " + std::to_string(startup_timer.seconds()) + "s after launch");
+                first_frame = false;
+            }
+
+            cv::Mat frame = item->dual->lowRes();
+            if (item->target >= 0) {
+                cv::drawMarker(frame, item->dual->toLowRes(item->target_center), cv::Scalar(255,0,0), cv::MARKER_CROSS, 200 / low_res_scale, 3);
+                cv::rectangle(frame, item->dual->toLowRes(item->detections.boxes[item->target]), cv::Scalar(255,0,0), 2, cv::LINE_8);
+            }
+            for (size_t i=0; i<item->track_ids.size(); i++) {
+                cv::putText(frame, std::to_string(item->track_ids[i]), item->dual->toLowRes(item->detections.boxes[i].tl()),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255,0,0), 2);
             }
             
-            cv::drawMarker(frame, cv::Point(800, 448), cv::Scalar(255,255,0), cv::MARKER_CROSS, 200, 4);
+            cv::drawMarker(frame, item->dual->toLowRes(cv::Point(800, 448)), cv::Scalar(255,255,0), cv::MARKER_CROSS, 200 / low_res_scale, 4);
             cv::imshow("Video Player", frame);//Showing the video//
-            char c = (char)cv::waitKey(25);//Allowing 25 milliseconds frame processing time and initiating break condition//
+            char c = (char)cv::waitKey(1);//Allowing 1 millisecond for events and initiating break condition//
             if (c == 27){ //If 'Esc' is entered break the loop//
                 break;
             }
         }
         
+        pipeline.stop();
+        spdlog::info("Pipeline stats:\n" + pipeline.printStats());
+        spdlog::info("Tracking stats: " + tracking_detector.printStats());
+        spdlog::info("SORT stats: " + sort_tracker.printStats());
+        spdlog::info("ROI stats: " + roi_detector.printStats());
+        spdlog::info("Resolution stats: " + governor.printStats());
+        if (cascade_detector) {
+            spdlog::info("Cascade stats: " + cascade_detector->printStats());
+        }
+        if (tiled_detector) {
+            spdlog::info("Tiled stats: " + tiled_detector->printStats());
+        }
+        spdlog::info("Motion gate stats: " + motion_gate.printStats());
+        spdlog::info("Proposal stats: " + proposal_detector.printStats());
+        spdlog::info("Mosaic stats: " + mosaic_packer.printStats());
+        spdlog::info("Frame timing: " + timing_monitor.printStats());
+        spdlog::info("Correction latency: " + std::to_string(controller.correction_latency.mean()) + "ms");
+        if (camera) {
+            spdlog::info("Capture stats: " + camera->printStats());
+            spdlog::info("Frame pool stats: " + frame_pool->printStats());
+            if (frame_pool->getStats().exhausted > 0) {
+                spdlog::warn("Frame pool ran out of buffers, something is holding frames past the pipeline");
+            }
+        }
         controller.returnToHome(WhichServo::BOTH, true);
         return 0;
     }
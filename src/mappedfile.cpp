@@ -0,0 +1,279 @@
+#include "mappedfile.hpp"
+
+
+MappedFile::MappedFile () {
+    
+    mapped = nullptr;
+    length = 0;
+#ifdef _WIN32
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = NULL;
+#endif
+}
+
+// --------------------------------------------------------------------------------------
+
+MappedFile::~MappedFile () {
+    close();
+}
+
+// --------------------------------------------------------------------------------------
+
+void MappedFile::open (std::string filename) {
+    /**
+     * Map the whole file into memory
+     * @param filename - file to map
+     * @throws runtime_error if the file cannot be opened or mapped
+    */
+
+    close();
+
+#ifdef _WIN32
+    file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Unable to open: " + filename);
+    }
+    
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file_handle, &file_size);
+    length = (size_t)file_size.QuadPart;
+    
+    mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping_handle == NULL) {
+        close();
+        throw std::runtime_error("Unable to map: " + filename);
+    }
+    
+    mapped = (unsigned char*)MapViewOfFile(mapping_handle, FILE_MAP_COPY, 0, 0, 0);
+    if (!mapped) {
+        close();
+        throw std::runtime_error("Unable to map: " + filename);
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open: " + filename);
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    length = (size_t)st.st_size;
+
+    void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        length = 0;
+        throw std::runtime_error("Unable to map: " + filename);
+    }
+    mapped = (unsigned char*)ptr;
+#endif
+}
+
+// --------------------------------------------------------------------------------------
+
+void MappedFile::close () {
+    /**
+     * Unmap the file. Any Mat headers over the mapping become invalid.
+    */
+
+#ifdef _WIN32
+    if (mapped) {
+        UnmapViewOfFile(mapped);
+    }
+    if (mapping_handle != NULL) {
+        CloseHandle(mapping_handle);
+        mapping_handle = NULL;
+    }
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_handle);
+        file_handle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (mapped) {
+        munmap(mapped, length);
+    }
+#endif
+    mapped = nullptr;
+    length = 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool MappedFile::isOpen () {
+    
+    return mapped != nullptr;
+}
+
+// --------------------------------------------------------------------------------------
+
+unsigned char* MappedFile::data () {
+    
+    return mapped;
+}
+
+// --------------------------------------------------------------------------------------
+
+size_t MappedFile::size () {
+    
+    return length;
+}
+
+// ======================================================================================
+
+SharedMemory::SharedMemory () {
+    
+    mapped = nullptr;
+    length = 0;
+    owner = false;
+#ifdef _WIN32
+    mapping_handle = NULL;
+#endif
+}
+
+// --------------------------------------------------------------------------------------
+
+SharedMemory::~SharedMemory () {
+    close();
+}
+
+// --------------------------------------------------------------------------------------
+
+void SharedMemory::create (std::string name, size_t size) {
+    /**
+     * Create (or replace) a named region and map it read/write
+     * @param name - region name, e.g. "/frame-bus"
+     * @param size - size in bytes
+     * @throws runtime_error if the region cannot be created
+    */
+
+    close();
+
+#ifdef _WIN32
+    mapping_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 
+        (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF), ("Local\\" + name).c_str());
+    if (mapping_handle == NULL) {
+        throw std::runtime_error("Unable to create shared memory: " + name);
+    }
+    mapped = (unsigned char*)MapViewOfFile(mapping_handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0666);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to create shared memory: " + name);
+    }
+    if (ftruncate(fd, size) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Unable to size shared memory: " + name);
+    }
+    
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    mapped = ptr == MAP_FAILED ? nullptr : (unsigned char*)ptr;
+#endif
+
+    region_name = name;
+    owner = true;
+    if (!mapped) {
+        close();
+        throw std::runtime_error("Unable to map shared memory: " + name);
+    }
+    length = size;
+}
+
+// --------------------------------------------------------------------------------------
+
+void SharedMemory::open (std::string name, bool readOnly) {
+    /**
+     * Map a region created by another process
+     * @param name - region name
+     * @param readOnly - map without write access
+     * @throws runtime_error if the region doesn't exist
+    */
+
+    close();
+
+#ifdef _WIN32
+    DWORD access = readOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS;
+    mapping_handle = OpenFileMappingA(access, FALSE, ("Local\\" + name).c_str());
+    if (mapping_handle == NULL) {
+        throw std::runtime_error("Unable to open shared memory: " + name);
+    }
+    mapped = (unsigned char*)MapViewOfFile(mapping_handle, access, 0, 0, 0);
+    
+    MEMORY_BASIC_INFORMATION info;
+    if (mapped && VirtualQuery(mapped, &info, sizeof info)) {
+        length = info.RegionSize;
+    }
+#else
+    int fd = shm_open(name.c_str(), readOnly ? O_RDONLY : O_RDWR, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open shared memory: " + name);
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    length = (size_t)st.st_size;
+    
+    void* ptr = mmap(nullptr, length, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    mapped = ptr == MAP_FAILED ? nullptr : (unsigned char*)ptr;
+#endif
+
+    region_name = name;
+    owner = false;
+    if (!mapped) {
+        close();
+        throw std::runtime_error("Unable to map shared memory: " + name);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void SharedMemory::close () {
+    /**
+     * Unmap the region, removing its name if this process created it
+    */
+
+#ifdef _WIN32
+    if (mapped) {
+        UnmapViewOfFile(mapped);
+    }
+    if (mapping_handle != NULL) {
+        CloseHandle(mapping_handle);
+        mapping_handle = NULL;
+    }
+#else
+    if (mapped) {
+        munmap(mapped, length);
+    }
+    if (owner) {
+        shm_unlink(region_name.c_str());
+    }
+#endif
+    mapped = nullptr;
+    length = 0;
+    owner = false;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool SharedMemory::isOpen () {
+    
+    return mapped != nullptr;
+}
+
+// --------------------------------------------------------------------------------------
+
+unsigned char* SharedMemory::data () {
+    
+    return mapped;
+}
+
+// --------------------------------------------------------------------------------------
+
+size_t SharedMemory::size () {
+    
+    return length;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+/**
+ * Private view of a whole file mapped into memory. The mapping is copy on write,
+ * so pages may be modified in memory without changing the file.
+*/
+class MappedFile {
+    public:
+        MappedFile ();
+        ~MappedFile ();
+        void open (std::string);
+        void close ();
+        bool isOpen ();
+        unsigned char* data ();
+        size_t size ();
+    protected:
+        unsigned char* mapped;
+        size_t length;
+#ifdef _WIN32
+        HANDLE file_handle;
+        HANDLE mapping_handle;
+#endif
+};
+
+/**
+ * Named shared memory region which other local processes can map.
+ * The creator removes the name when it closes the region.
+*/
+class SharedMemory {
+    public:
+        SharedMemory ();
+        ~SharedMemory ();
+        void create (std::string, size_t);
+        void open (std::string, bool = true);
+        void close ();
+        bool isOpen ();
+        unsigned char* data ();
+        size_t size ();
+    protected:
+        unsigned char* mapped;
+        size_t length;
+        std::string region_name;
+        bool owner;
+#ifdef _WIN32
+        HANDLE mapping_handle;
+#endif
+};
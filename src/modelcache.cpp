@@ -0,0 +1,77 @@
+#include "modelcache.hpp"
+
+
+ModelCache::ModelCache (std::string configFile, std::string weightsFile) {
+    /**
+     * Map the model files
+     * @param configFile - Darknet .cfg file
+     * @param weightsFile - Darknet .weights file
+     * @throws if either file can't be mapped
+    */
+
+    utils::Timer timer;
+    config.open(configFile);
+    weights.open(weightsFile);
+    stats.map_ms = timer.seconds() * 1000;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::dnn::Net ModelCache::create (int backend, int target, cv::Size warmUpSize) {
+    /**
+     * Build a network from the mapped files
+     * @param backend - cv::dnn backend
+     * @param target - cv::dnn target
+     * @param warmUpSize - input size to warm the network up at, empty to skip it
+     * @returns a network only the caller uses, since sharing one between input sizes
+     *          would reallocate its layers at every switch
+    */
+
+    utils::Timer timer;
+    cv::dnn::Net net = cv::dnn::readNetFromDarknet((const char*)config.data(), config.size(),
+        (const char*)weights.data(), weights.size());
+    net.setPreferableBackend(backend);
+    net.setPreferableTarget(target);
+    stats.parse_ms += timer.seconds() * 1000;
+    stats.nets++;
+
+    if (!warmUpSize.empty()) {
+        stats.warmup_ms += warmUp(net, warmUpSize);
+    }
+    return net;
+}
+
+// --------------------------------------------------------------------------------------
+
+double ModelCache::warmUp (cv::dnn::Net &net, cv::Size size) {
+    /**
+     * Run a forward pass on a blank input, through the same outputs detection uses
+     * @param net - network to warm up
+     * @param size - network input size
+     * @returns milliseconds taken
+    */
+
+    utils::Timer timer;
+    cv::Mat blank = cv::Mat::zeros(size, CV_8UC3);
+    net.setInput(cv::dnn::blobFromImage(blank, 1.0/255, size));
+    std::vector<cv::Mat> outs;
+    net.forward(outs, net.getUnconnectedOutLayersNames());
+    return timer.seconds() * 1000;
+}
+
+// --------------------------------------------------------------------------------------
+
+ModelLoadStats ModelCache::getStats () {
+
+    return stats;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string ModelCache::printStats () {
+
+    std::ostringstream oss;
+    oss << stats.nets << " nets, map " << stats.map_ms << "ms, parse " << stats.parse_ms
+        << "ms, warm up " << stats.warmup_ms << "ms";
+    return oss.str();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "mappedfile.hpp"
+#include "utils.hpp"
+
+struct ModelLoadStats {
+    double map_ms = 0.0;
+    double parse_ms = 0.0;
+    double warmup_ms = 0.0;
+    int nets = 0;
+};
+
+/**
+ * Keeps a Darknet model's files mapped for the life of the process, so every network
+ * built from them is parsed from memory rather than read from disk again. Each
+ * network gets a warm up forward pass at its input size when it's created, which is
+ * when cv::dnn allocates and fuses its layers, so the first real frame isn't slow.
+ * Only the disk read is shared: every create() still parses the cfg, copies the
+ * weights and warms up, so startup grows with the number of networks. startup-bench
+ * times the set main builds.
+*/
+class ModelCache {
+    public:
+        ModelCache (std::string, std::string);
+        cv::dnn::Net create (int = cv::dnn::DNN_BACKEND_OPENCV, int = cv::dnn::DNN_TARGET_CPU, cv::Size = cv::Size());
+        static double warmUp (cv::dnn::Net &, cv::Size);
+        ModelLoadStats getStats ();
+        std::string printStats ();
+
+    protected:
+        MappedFile config;
+        MappedFile weights;
+        ModelLoadStats stats;
+};
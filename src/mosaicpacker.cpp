@@ -0,0 +1,200 @@
+#include "mosaicpacker.hpp"
+
+
+MosaicPacker::MosaicPacker (Detector &mosaicDetector, int seamGap, float seamTolerance) : detector(mosaicDetector) {
+    /**
+     * @param mosaicDetector - detector run on the canvas, whose input size is the canvas size
+     * @param seamGap - pixels of gray between regions
+     * @param seamTolerance - fraction of a box's area allowed outside its region
+    */
+
+    gap = seamGap;
+    seam_tolerance = seamTolerance;
+    scale = 0.0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void MosaicPacker::detect (const std::vector<cv::Mat> &regions, std::vector<Detections> &results) {
+    /**
+     * Detect on every region with one inference
+     * @param regions - 8 bit color images, e.g. crops of one or more frames
+     * @param results - boxes for each region, in that region's coordinates
+    */
+
+    results.resize(regions.size());
+    for (auto &result : results) {
+        result.clear();
+    }
+    if (regions.empty()) {
+        return;
+    }
+
+    utils::Timer timer;
+    sizes.clear();
+    for (auto &region : regions) {
+        sizes.push_back(region.size());
+    }
+    cv::Size canvas_size = detector.getInputSize();
+    if (!pack(sizes, canvas_size)) {
+        spdlog::warn("Mosaic: " + std::to_string(regions.size()) + " regions don't fit the canvas");
+        return;
+    }
+
+    canvas.create(canvas_size, CV_8UC3);
+    canvas.setTo(cv::Scalar::all(114));
+    int filled = 0;
+    for (size_t i=0; i<regions.size(); i++) {
+        cv::Mat cell = canvas(placements[i]);
+        cv::resize(regions[i], cell, cell.size(), 0, 0, cv::INTER_AREA);
+        filled += placements[i].area();
+    }
+    pack_ms.add(timer.seconds() * 1000);
+
+    timer.start();
+    detector.detect(canvas, found);
+    detect_ms.add(timer.seconds() * 1000);
+
+    for (size_t i=0; i<found.size(); i++) {
+        const cv::Rect &box = found.boxes[i];
+        cv::Point center = box.tl() + cv::Point(box.width / 2, box.height / 2);
+        auto cell = std::find_if(placements.begin(), placements.end(), [&] (const cv::Rect &p) { return p.contains(center); });
+        if (cell == placements.end() || (box & *cell).area() < (1.0f - seam_tolerance) * box.area()) {
+            stats.seam_discarded++;
+            continue;
+        }
+        cv::Rect inside = box & *cell;
+        cv::Rect mapped (cvRound((inside.x - cell->x) / scale), cvRound((inside.y - cell->y) / scale),
+            cvRound(inside.width / scale), cvRound(inside.height / scale));
+        size_t source = cell - placements.begin();
+        results[source].add(found.class_ids[i], found.confidences[i], mapped & cv::Rect(cv::Point(), regions[source].size()));
+        stats.boxes++;
+    }
+
+    stats.canvases++;
+    stats.rois += regions.size();
+    scales.add(scale);
+    fill.add((double)filled / canvas_size.area());
+}
+
+// --------------------------------------------------------------------------------------
+
+bool MosaicPacker::pack (const std::vector<cv::Size> &regionSizes, cv::Size canvasSize) {
+    /**
+     * Find the largest common scale, up to 1, at which the regions fit on shelves
+     * @param regionSizes - size of each region
+     * @param canvasSize - size to pack them into
+     * @returns false if they don't fit even at a tiny scale
+    */
+
+    double high = 1.0;
+    for (auto &size : regionSizes) {
+        high = std::min({high, (double)canvasSize.width / size.width, (double)canvasSize.height / size.height});
+    }
+
+    // Shelf packing gets tighter as the scale drops, so search for the largest scale that fits
+    scale = 0.0;
+    if (shelfPack(regionSizes, canvasSize, high, trial)) {
+        scale = high;
+        placements = trial;
+        return true;
+    }
+    double low = 0.0;
+    for (int i=0; i<12; i++) {
+        double middle = (low + high) / 2;
+        if (shelfPack(regionSizes, canvasSize, middle, trial)) {
+            low = middle;
+            scale = middle;
+            placements = trial;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return scale > 0.0;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat MosaicPacker::getCanvas () {
+    /**
+     * The last canvas detected on
+    */
+
+    return canvas;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::vector<cv::Rect> MosaicPacker::getPlacements () {
+    /**
+     * Where each region went on the last canvas
+    */
+
+    return placements;
+}
+
+// --------------------------------------------------------------------------------------
+
+double MosaicPacker::getScale () {
+
+    return scale;
+}
+
+// --------------------------------------------------------------------------------------
+
+MosaicStats MosaicPacker::getStats () {
+
+    MosaicStats s = stats;
+    s.mean_scale = scales.mean();
+    s.mean_fill = fill.mean();
+    s.mean_pack_ms = pack_ms.mean();
+    s.mean_detect_ms = detect_ms.mean();
+    return s;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string MosaicPacker::printStats () {
+
+    MosaicStats s = getStats();
+    std::ostringstream oss;
+    oss << s.canvases << " canvases of " << s.rois << " regions, scale " << s.mean_scale << ", fill "
+        << s.mean_fill * 100 << "%, boxes: " << s.boxes << ", seam discarded: " << s.seam_discarded
+        << ", pack: " << s.mean_pack_ms << "ms, detect: " << s.mean_detect_ms << "ms";
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+bool MosaicPacker::shelfPack (const std::vector<cv::Size> &regionSizes, cv::Size canvasSize, double factor,
+    std::vector<cv::Rect> &placed) {
+
+    /**
+     * Place the scaled regions left to right on shelves, tallest first
+     * @returns false if they run off the bottom of the canvas
+    */
+
+    order.resize(regionSizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&] (int a, int b) { return regionSizes[a].height > regionSizes[b].height; });
+
+    placed.resize(regionSizes.size());
+    int x = 0, y = 0, shelf = 0;
+    for (int i : order) {
+        int width = std::max(1, (int)(regionSizes[i].width * factor));
+        int height = std::max(1, (int)(regionSizes[i].height * factor));
+        if (x > 0 && x + width > canvasSize.width) {
+            x = 0;
+            y += shelf + gap;
+            shelf = 0;
+        }
+        if (x + width > canvasSize.width || y + height > canvasSize.height) {
+            return false;
+        }
+        placed[i] = cv::Rect(x, y, width, height);
+        x += width + gap;
+        shelf = std::max(shelf, height);
+    }
+    return true;
+}
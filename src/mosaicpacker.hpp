@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "detector.hpp"
+#include "framemetadata.hpp"
+#include "utils.hpp"
+
+struct MosaicStats {
+    uint64_t canvases = 0;
+    uint64_t rois = 0;
+    uint64_t boxes = 0;
+    uint64_t seam_discarded = 0;
+    double mean_scale = 0.0;
+    double mean_fill = 0.0;
+    double mean_pack_ms = 0.0;
+    double mean_detect_ms = 0.0;
+};
+
+/**
+ * Packs several regions into one detector sized canvas so they cost a single
+ * inference rather than one each. Regions are placed on shelves, tallest first,
+ * all scaled by the largest common factor that fits them, never enlarged, with a
+ * gap of flat gray between them. Boxes are mapped back to the region their center
+ * lies in; a box reaching more than the seam tolerance of its area outside that
+ * region spans a seam, so it isn't any one region's object and is discarded.
+*/
+class MosaicPacker {
+    public:
+        MosaicPacker (Detector &, int = 8, float = 0.1);
+        void detect (const std::vector<cv::Mat> &, std::vector<Detections> &);
+        bool pack (const std::vector<cv::Size> &, cv::Size);
+        cv::Mat getCanvas ();
+        std::vector<cv::Rect> getPlacements ();
+        double getScale ();
+        MosaicStats getStats ();
+        std::string printStats ();
+
+    protected:
+        bool shelfPack (const std::vector<cv::Size> &, cv::Size, double, std::vector<cv::Rect> &);
+
+        Detector &detector;
+        int gap;
+        float seam_tolerance;
+        cv::Mat canvas;
+        std::vector<cv::Size> sizes;
+        std::vector<int> order;
+        std::vector<cv::Rect> placements;
+        std::vector<cv::Rect> trial;
+        double scale;
+        Detections found;
+        MosaicStats stats;
+        RollingStat scales;
+        RollingStat fill;
+        RollingStat pack_ms;
+        RollingStat detect_ms;
+};
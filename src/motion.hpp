@@ -0,0 +1,17 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * Whether the camera was moving at a given grab time
+*/
+typedef std::function<bool (std::chrono::steady_clock::time_point)> ServoActivity;
+
+/**
+ * Predicts how far the image moved between two grab times because of the camera's
+ * own motion, in frame pixels
+*/
+typedef std::function<cv::Point (std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point)> CameraMotion;
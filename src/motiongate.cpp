@@ -0,0 +1,107 @@
+#include "motiongate.hpp"
+
+
+MotionGate::MotionGate (double maxIdleSeconds, int pixelThreshold, double changedThreshold) {
+    /**
+     * @param maxIdleSeconds - longest time to go without detecting
+     * @param pixelThreshold - gray level difference for a pixel to count as changed
+     * @param changedThreshold - fraction of changed pixels that counts as motion
+    */
+
+    max_idle_seconds = maxIdleSeconds;
+    pixel_threshold = pixelThreshold;
+    changed_threshold = changedThreshold;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool MotionGate::check (const cv::Mat &gray, std::chrono::steady_clock::time_point grabTime) {
+    /**
+     * Decide whether a frame needs detection. A frame that does becomes the reference.
+     * @param gray - downscaled grayscale image of the frame
+     * @param grabTime - capture time of the frame
+     * @returns true to detect, false to keep the last result
+    */
+
+    stats.frames++;
+    cv::GaussianBlur(gray, blurred, cv::Size(5, 5), 0);
+
+    bool detect = true;
+    if (reference.empty() || reference.size() != blurred.size()) {
+        stats.forced++;
+    }
+    else if (servo_activity && servo_activity(grabTime)) {
+        stats.servo++;
+    }
+    else if (std::chrono::duration<double>(grabTime - last_detection).count() >= max_idle_seconds) {
+        stats.forced++;
+    }
+    else {
+        double changed = changedFraction(blurred);
+        if (changed >= changed_threshold) {
+            stats.motion++;
+        }
+        else {
+            stats.skipped++;
+            detect = false;
+        }
+        stats.mean_changed += (changed - stats.mean_changed) / (stats.motion + stats.skipped);
+    }
+
+    if (detect) {
+        std::swap(reference, blurred);
+        last_detection = grabTime;
+    }
+    return detect;
+}
+
+// --------------------------------------------------------------------------------------
+
+void MotionGate::setServoActivity (ServoActivity servoActivity) {
+    /**
+     * @param servoActivity - frames grabbed while it returns true are always detected,
+     *        since the whole image shifts and the last result no longer holds
+    */
+
+    servo_activity = servoActivity;
+}
+
+// --------------------------------------------------------------------------------------
+
+void MotionGate::reset () {
+    /**
+     * Forget the reference so the next frame is detected
+    */
+
+    reference.release();
+}
+
+// --------------------------------------------------------------------------------------
+
+MotionGateStats MotionGate::getStats () {
+
+    return stats;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string MotionGate::printStats () {
+
+    std::ostringstream oss;
+    oss << stats.frames << " frames, skipped: " << stats.skipped << ", motion: " << stats.motion
+        << ", servo: " << stats.servo << ", forced: " << stats.forced
+        << ", mean changed: " << stats.mean_changed * 100 << "%";
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+double MotionGate::changedFraction (const cv::Mat &image) {
+    /**
+     * Fraction of pixels that differ from the reference by more than the threshold
+    */
+
+    cv::absdiff(image, reference, difference);
+    cv::threshold(difference, difference, pixel_threshold, 255, cv::THRESH_BINARY);
+    return (double)cv::countNonZero(difference) / difference.total();
+}
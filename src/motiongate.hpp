@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+#include "motion.hpp"
+
+struct MotionGateStats {
+    uint64_t frames = 0;
+    uint64_t motion = 0;
+    uint64_t servo = 0;
+    uint64_t forced = 0;
+    uint64_t skipped = 0;
+    double mean_changed = 0.0;
+};
+
+/**
+ * Decides whether a frame needs detection by differencing a small grayscale image
+ * against the one from the last frame that was detected on. A static scene with
+ * idle servos skips detection, since its last result still holds. Detection is
+ * forced after maxIdleSeconds so nothing goes unchecked for long. Comparing with
+ * the last detected frame rather than the previous one lets slow changes add up.
+*/
+class MotionGate {
+    public:
+        MotionGate (double = 2.0, int = 25, double = 0.002);
+        bool check (const cv::Mat &, std::chrono::steady_clock::time_point);
+        void setServoActivity (ServoActivity);
+        void reset ();
+        MotionGateStats getStats ();
+        std::string printStats ();
+
+    protected:
+        double changedFraction (const cv::Mat &);
+
+        double max_idle_seconds;
+        int pixel_threshold;
+        double changed_threshold;
+        ServoActivity servo_activity;
+
+        cv::Mat reference;
+        cv::Mat blurred;
+        cv::Mat difference;
+        std::chrono::steady_clock::time_point last_detection;
+        MotionGateStats stats;
+};
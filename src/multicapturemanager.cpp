@@ -0,0 +1,233 @@
+#include "multicapturemanager.hpp"
+
+
+MultiCaptureManager::MultiCaptureManager (double toleranceMs, size_t historySize) {
+    /**
+     * @param toleranceMs - largest allowed difference between grab times in a set
+     * @param historySize - frames kept per source while waiting for a match
+    */
+
+    tolerance_ms = toleranceMs;
+    history_size = std::max(historySize, (size_t)1);
+    running = 0;
+    read_timeout = std::chrono::milliseconds(2000);
+}
+
+// -------------------------------------------------------------------------
+
+MultiCaptureManager::~MultiCaptureManager () {
+    close();
+}
+
+// -------------------------------------------------------------------------
+
+void MultiCaptureManager::open (std::vector<int> sourceIndexes, int api) {
+    /**
+     * Open every camera with the default properties and start a grab thread for each
+     * @param sourceIndexes - camera indexes
+     * @param api - capture api
+     * @throws if any camera fails to open
+    */
+
+    close();
+    for (int index : sourceIndexes) {
+        auto camera = std::make_unique<CameraCaptureManager>();
+        camera->open(index, api);
+        sources.push_back(std::move(camera));
+    }
+
+    histories.resize(sources.size());
+    running = sources.size();
+    for (size_t i=0; i<sources.size(); i++) {
+        grab_threads.emplace_back([this, i] (std::stop_token stopToken) { grabLoop(i, stopToken); });
+    }
+}
+
+// -------------------------------------------------------------------------
+
+void MultiCaptureManager::grabLoop (size_t sourceIndex, std::stop_token stopToken) {
+    /**
+     * Thread body for one camera. Appends frames to the camera's history, 
+     * dropping the oldest frame once the history is full.
+    */
+
+    while (!stopToken.stop_requested()) {
+        TimedFrame timed;
+        if (!sources[sourceIndex]->read(timed.frame, timed.metadata)) {
+            spdlog::error("Grab thread failed to read a frame from source " + std::to_string(sourceIndex));
+            break;
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock (history_mutex);
+            std::deque<TimedFrame> &history = histories[sourceIndex];
+            history.push_back(std::move(timed));
+            if (history.size() > history_size) {
+                history.pop_front();
+                stats.frames_dropped++;
+            }
+        }
+        history_cond.notify_one();
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock (history_mutex);
+        running--;
+    }
+    history_cond.notify_all();
+}
+
+// -------------------------------------------------------------------------
+
+double MultiCaptureManager::millisecondsBetween (std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    
+    return std::abs(std::chrono::duration<double, std::milli>(a - b).count());
+}
+
+// -------------------------------------------------------------------------
+
+bool MultiCaptureManager::matchLocked (FrameSet &frameSet) {
+    /**
+     * Try to build a frame set. The reference time is the newest frame of the source
+     * which is furthest behind; every source contributes its frame nearest that time. 
+     * If the set doesn't fit the tolerance, frames at or before the reference time can 
+     * never be matched and are discarded. The history mutex must be held.
+     * @param frameSet - filled in when a match is found
+     * @returns true if a set was delivered
+    */
+
+    for (auto &history : histories) {
+        if (history.empty()) {
+            return false;
+        }
+    }
+
+    auto reference = histories[0].back().metadata.grab_time;
+    for (auto &history : histories) {
+        reference = std::min(reference, history.back().metadata.grab_time);
+    }
+
+    std::vector<size_t> chosen;
+    auto earliest = reference;
+    auto latest = reference;
+    for (auto &history : histories) {
+        size_t best = 0;
+        for (size_t i=1; i<history.size(); i++) {
+            if (millisecondsBetween(history[i].metadata.grab_time, reference) < millisecondsBetween(history[best].metadata.grab_time, reference)) {
+                best = i;
+            }
+        }
+        chosen.push_back(best);
+        earliest = std::min(earliest, history[best].metadata.grab_time);
+        latest = std::max(latest, history[best].metadata.grab_time);
+    }
+
+    double spread = millisecondsBetween(latest, earliest);
+    if (spread > tolerance_ms) {
+        for (auto &history : histories) {
+            while (!history.empty() && history.front().metadata.grab_time <= reference) {
+                history.pop_front();
+                stats.frames_dropped++;
+            }
+        }
+        stats.sets_unmatched++;
+        return false;
+    }
+
+    frameSet.frames.clear();
+    frameSet.metadata.clear();
+    frameSet.spread_ms = spread;
+    for (size_t s=0; s<histories.size(); s++) {
+        std::deque<TimedFrame> &history = histories[s];
+        frameSet.frames.push_back(history[chosen[s]].frame);
+        frameSet.metadata.push_back(history[chosen[s]].metadata);
+        
+        // Frames older than the chosen one are stale now
+        stats.frames_dropped += chosen[s];
+        history.erase(history.begin(), history.begin() + chosen[s] + 1);
+    }
+    stats.sets_delivered++;
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+bool MultiCaptureManager::read (FrameSet &frameSet) {
+    /**
+     * Wait for the next matched frame set
+     * @param frameSet - filled with one frame per source, in source order
+     * @returns false if a source stopped or no set matched within the timeout
+    */
+
+    std::unique_lock<std::mutex> lock (history_mutex);
+    auto deadline = std::chrono::steady_clock::now() + read_timeout;
+    
+    while (!matchLocked(frameSet)) {
+        if (running < sources.size() || sources.empty()) {
+            return false;
+        }
+        if (history_cond.wait_until(lock, deadline) == std::cv_status::timeout) {
+            return matchLocked(frameSet);
+        }
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+void MultiCaptureManager::close () {
+    /**
+     * Stop every grab thread and release the cameras
+    */
+
+    for (auto &thread : grab_threads) {
+        thread.request_stop();
+    }
+    grab_threads.clear();
+    sources.clear();
+    histories.clear();
+    running = 0;
+}
+
+// -------------------------------------------------------------------------
+
+size_t MultiCaptureManager::size () {
+    
+    return sources.size();
+}
+
+// -------------------------------------------------------------------------
+
+CameraCaptureManager* MultiCaptureManager::source (size_t sourceIndex) {
+    /**
+     * Access a camera, e.g. to read or change its properties
+    */
+
+    return sourceIndex < sources.size() ? sources[sourceIndex].get() : nullptr;
+}
+
+// -------------------------------------------------------------------------
+
+void MultiCaptureManager::setReadTimeout (double seconds) {
+    
+    read_timeout = std::chrono::milliseconds((long)(seconds * 1000));
+}
+
+// -------------------------------------------------------------------------
+
+MultiCaptureStats MultiCaptureManager::getStats () {
+    
+    const std::lock_guard<std::mutex> lock (history_mutex);
+    return stats;
+}
+
+// -------------------------------------------------------------------------
+
+std::string MultiCaptureManager::printStats () {
+    
+    MultiCaptureStats s = getStats();
+    std::ostringstream oss;
+    oss << "sets delivered: " << s.sets_delivered << ", unmatched: " << s.sets_unmatched 
+        << ", frames dropped: " << s.frames_dropped;
+    return oss.str();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include "cameracapturemanager.hpp"
+
+/**
+ * One frame from each source, grabbed within the tolerance of each other.
+ * spread_ms is the time between the earliest and latest grab in the set.
+*/
+struct FrameSet {
+    std::vector<cv::Mat> frames;
+    std::vector<FrameMetadata> metadata;
+    double spread_ms = 0.0;
+};
+
+struct MultiCaptureStats {
+    uint64_t sets_delivered = 0;
+    uint64_t sets_unmatched = 0;
+    uint64_t frames_dropped = 0;
+};
+
+/**
+ * Capture manager for several cameras in one process. Each camera is grabbed on its
+ * own thread into a short history, and read() delivers the set of frames whose grab 
+ * times are nearest to each other, provided they fall within the tolerance.
+*/
+class MultiCaptureManager {
+    public:
+        MultiCaptureManager (double = 10.0, size_t = 4);
+        ~MultiCaptureManager ();
+        void open (std::vector<int>, int = cv::CAP_DSHOW);
+        bool read (FrameSet &);
+        void close ();
+        size_t size ();
+        CameraCaptureManager* source (size_t);
+        void setReadTimeout (double);
+        MultiCaptureStats getStats ();
+        std::string printStats ();
+        
+    protected:
+        struct TimedFrame {
+            cv::Mat frame;
+            FrameMetadata metadata;
+        };
+
+        void grabLoop (size_t, std::stop_token);
+        bool matchLocked (FrameSet &);
+        static double millisecondsBetween (std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point);
+
+        std::vector<std::unique_ptr<CameraCaptureManager>> sources;
+        std::vector<std::deque<TimedFrame>> histories;
+        std::vector<std::jthread> grab_threads;
+        std::mutex history_mutex;
+        std::condition_variable history_cond;
+        size_t running;
+        double tolerance_ms;
+        size_t history_size;
+        std::chrono::milliseconds read_timeout;
+        MultiCaptureStats stats;
+};
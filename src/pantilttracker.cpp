@@ -14,6 +14,7 @@ PanTiltTracker::PanTiltTracker (Channel _pan, Channel _tilt, std::string calibra
     : PanTilt (_pan, _tilt, calibrationFile) {
 
     props = trackerProps;
+    correction_latency = RollingStat(120);
 
     int x = props.frame_dims.x / 2 + (int)(std::get<0>(props.center_offset) * props.frame_dims.x / 2);
     int y = props.frame_dims.y / 2 + (int)(std::get<1>(props.center_offset) * props.frame_dims.y / 2);
@@ -91,9 +92,105 @@ std::tuple<float, int> PanTiltTracker::correct (cv::Point regionCenter, int fps)
         }
 
         
-        return calculateMovementTime (x_correct, y_correct, fps);     
+        auto movement = calculateMovementTime (x_correct, y_correct, fps);
+        recordMove(x_correct, y_correct, std::get<0>(movement));
+        return movement;     
     }
 
     return std::make_tuple(0.0, 0);   
 
-}
\ No newline at end of file
+}
+
+// --------------------------------------------------------------------------------------------
+
+std::tuple<float, int> PanTiltTracker::correct (cv::Point regionCenter, const FrameMetadata &metadata, int fps) {
+    /**
+     * Correct towards the region center found in the given frame, recording how old 
+     * the frame was when the correction was issued (glass to servo latency)
+     * @param regionCenter - x,y of center
+     * @param metadata - capture metadata of the frame the center was found in
+     * @param fps - frame rate used to convert movement time to frames
+     * @returns tuple of movement seconds and frames to skip
+    */
+
+    correction_latency.add(metadata.ageMilliseconds());
+    return correct(regionCenter, fps);
+}
+
+// --------------------------------------------------------------------------------------------
+
+cv::Point2f PanTiltTracker::degreesToPixels (float panDegrees, float tiltDegrees) {
+    /**
+     * How far a pan/tilt move shifts the image, the inverse of calculateCorrectionDegrees
+     * @param panDegrees - relative pan
+     * @param tiltDegrees - relative tilt
+     * @returns shift in frame pixels of anything in view
+    */
+
+    float x = -std::tan(panDegrees * _M_PI / 180.0) * props.frame_dims.y;
+    float y = std::tan(tiltDegrees * _M_PI / 180.0) * props.frame_dims.x;
+    return cv::Point2f(x, y);
+}
+
+// --------------------------------------------------------------------------------------------
+
+cv::Point PanTiltTracker::imageShift (std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    /**
+     * Predict how far the servo moves issued so far shifted the image between two 
+     * frames, assuming each move runs at a constant speed over its movement time
+     * @param from - grab time of the earlier frame
+     * @param to - grab time of the later frame
+     * @returns shift in frame pixels
+    */
+
+    auto completed = [] (const ServoMove &move, std::chrono::steady_clock::time_point when) {
+        if (move.seconds <= 0) {
+            return when >= move.issued ? 1.0f : 0.0f;
+        }
+        float elapsed = std::chrono::duration<float> (when - move.issued).count();
+        return std::clamp(elapsed / move.seconds, 0.0f, 1.0f);
+    };
+
+    const std::lock_guard<std::mutex> lock (moves_mutex);
+    cv::Point2f shift;
+    for (const auto &move : moves) {
+        shift += move.shift * (completed(move, to) - completed(move, from));
+    }
+    return cv::Point(cvRound(shift.x), cvRound(shift.y));
+}
+
+// --------------------------------------------------------------------------------------------
+
+bool PanTiltTracker::isMoving (std::chrono::steady_clock::time_point when, float settleSeconds) {
+    /**
+     * Whether any move issued so far was still running at a given time
+     * @param when - time to check, normally a frame's grab time
+     * @param settleSeconds - time allowed after a move's movement time for the servos to settle
+     * @returns true if the camera was moving
+    */
+
+    const std::lock_guard<std::mutex> lock (moves_mutex);
+    for (const auto &move : moves) {
+        auto end = move.issued + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<float>(std::max(move.seconds, 0.0f) + settleSeconds));
+        if (when >= move.issued && when < end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// --------------------------------------------------------------------------------------------
+
+void PanTiltTracker::recordMove (float panDegrees, float tiltDegrees, float seconds) {
+    /**
+     * Remember a move for imageShift, forgetting those long finished
+    */
+
+    auto now = std::chrono::steady_clock::now();
+    const std::lock_guard<std::mutex> lock (moves_mutex);
+    moves.push_back(ServoMove{now, seconds, degreesToPixels(panDegrees, tiltDegrees)});
+    while (moves.size() > 1 && now - moves.front().issued > std::chrono::seconds(5)) {
+        moves.pop_front();
+    }
+}
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "pantilt.hpp"
+#include "framemetadata.hpp"
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <deque>
+#include <mutex>
 
 
 const long double _M_PI = acosl(-1.0L);
@@ -22,6 +27,16 @@ class TrackerProperties {
 };
 
 
+/**
+ * A correction issued to the servos, kept so the image shift it causes can be predicted
+*/
+struct ServoMove {
+    std::chrono::steady_clock::time_point issued;
+    float seconds;
+    cv::Point2f shift;
+};
+
+
 class PanTiltTracker : public PanTilt {
 
     public:
@@ -32,4 +47,15 @@ class PanTiltTracker : public PanTilt {
         cv::Point frame_center;
         bool calculateCorrectionDegrees (cv::Point, IntOffset &);
         std::tuple<float, int> correct (cv::Point, int = 30);
+        std::tuple<float, int> correct (cv::Point, const FrameMetadata &, int = 30);
+        cv::Point2f degreesToPixels (float, float);
+        cv::Point imageShift (std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point);
+        bool isMoving (std::chrono::steady_clock::time_point, float = 0.1);
+        RollingStat correction_latency;
+
+    protected:
+        void recordMove (float, float, float);
+        
+        std::deque<ServoMove> moves;
+        std::mutex moves_mutex;
 };
\ No newline at end of file
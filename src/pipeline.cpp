@@ -0,0 +1,314 @@
+#include "pipeline.hpp"
+
+
+void PipelineFrame::reset () {
+    /**
+     * Clear the per frame results before the item is reused
+    */
+
+    metadata = FrameMetadata();
+    detect = true;
+    detections.clear();
+    track_ids.clear();
+    target = -1;
+    target_center = cv::Point();
+}
+
+// ======================================================================================
+
+Pipeline::Pipeline () {
+    
+    output = std::make_unique<PipelineQueue>(2, QueuePolicy::DROP_OLDEST);
+}
+
+// --------------------------------------------------------------------------------------
+
+Pipeline::~Pipeline () {
+    stop();
+}
+
+// --------------------------------------------------------------------------------------
+
+void Pipeline::setSource (std::string name, StageFunction function) {
+    /**
+     * Set the first stage, which fills in a new frame each call
+     * @param name - stage name for stats
+     * @param function - returns false at the end of the stream
+    */
+
+    auto stage = std::make_unique<Stage>();
+    stage->name = name;
+    stage->function = function;
+    
+    if (stages.empty()) {
+        stages.push_back(std::move(stage));
+    }
+    else {
+        stages[0] = std::move(stage);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void Pipeline::addStage (std::string name, StageFunction function, size_t queueCapacity, QueuePolicy policy) {
+    /**
+     * Append a stage after the source or the last stage added
+     * @param name - stage name for stats
+     * @param function - returns false to drop the frame
+     * @param queueCapacity - capacity of the queue feeding this stage
+     * @param policy - whether a full input queue blocks the previous stage or drops its oldest frame
+    */
+
+    if (stages.empty()) {
+        throw std::runtime_error("Pipeline source must be set before adding stages");
+    }
+
+    auto stage = std::make_unique<Stage>();
+    stage->name = name;
+    stage->function = function;
+    stage->input = std::make_unique<PipelineQueue>(queueCapacity, policy);
+    stages.push_back(std::move(stage));
+}
+
+// --------------------------------------------------------------------------------------
+
+void Pipeline::setOutput (size_t queueCapacity, QueuePolicy policy) {
+    /**
+     * Configure the queue between the last stage and pop()
+    */
+
+    output = std::make_unique<PipelineQueue>(queueCapacity, policy);
+}
+
+// --------------------------------------------------------------------------------------
+
+size_t Pipeline::getItemCount () {
+    /**
+     * Number of items start() preallocates: every queue full plus one in each stage
+     * and one with the consumer. Each item keeps its frame's buffers while idle, so a 
+     * frame pool feeding the source needs at least this many buffers plus its own.
+    */
+
+    size_t item_count = output->capacity() + stages.size() + 1;
+    for (size_t i=1; i<stages.size(); i++) {
+        item_count += stages[i]->input->capacity();
+    }
+    return item_count;
+}
+
+// --------------------------------------------------------------------------------------
+
+void Pipeline::start () {
+    /**
+     * Start a thread per stage. Enough items are preallocated to fill every queue
+     * with one more in each stage, so steady state runs without allocating frames.
+    */
+
+    if (stages.empty()) {
+        throw std::runtime_error("Pipeline has no source");
+    }
+
+    size_t item_count = getItemCount();
+    items.clear();
+    for (size_t i=0; i<item_count; i++) {
+        items.push_back(std::make_shared<PipelineFrame>());
+    }
+
+    stages[0]->thread = std::jthread([this] (std::stop_token stopToken) { runSource(stopToken); });
+    for (size_t i=1; i<stages.size(); i++) {
+        stages[i]->thread = std::jthread([this, i] (std::stop_token stopToken) { runStage(i, stopToken); });
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void Pipeline::stop () {
+    /**
+     * Stop and join every stage thread. Queued frames are discarded.
+    */
+
+    for (auto &stage : stages) {
+        stage->thread.request_stop();
+    }
+    for (auto &stage : stages) {
+        if (stage->thread.joinable()) {
+            stage->thread.join();
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+PipelineQueue& Pipeline::outputOf (size_t stageIndex) {
+    
+    return stageIndex + 1 < stages.size() ? *stages[stageIndex + 1]->input : *output;
+}
+
+// --------------------------------------------------------------------------------------
+
+PipelineItem Pipeline::acquireItem () {
+    /**
+     * Get an item no stage is holding. Falls back to a new item if all are in use.
+    */
+
+    for (auto &item : items) {
+        if (item.use_count() == 1) {
+            item->reset();
+            return item;
+        }
+    }
+    return std::make_shared<PipelineFrame>();
+}
+
+// --------------------------------------------------------------------------------------
+
+void Pipeline::record (Stage &stage, double milliseconds, bool kept) {
+    
+    const std::lock_guard<std::mutex> lock (stage.stats_mutex);
+    stage.latency.add(milliseconds);
+    stage.processed++;
+    if (!kept) {
+        stage.discarded++;
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void Pipeline::runSource (std::stop_token stopToken) {
+    /**
+     * Source thread body. Runs until the source reports the end of the stream.
+    */
+
+    Stage &stage = *stages[0];
+    PipelineQueue &next = outputOf(0);
+    
+    while (!stopToken.stop_requested()) {
+        PipelineItem item = acquireItem();
+        
+        auto start = std::chrono::steady_clock::now();
+        if (!stage.function(*item)) {
+            break;
+        }
+        record(stage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), true);
+        
+        next.push(std::move(item), stopToken);
+    }
+    
+    stage.done = true;
+    spdlog::info("Pipeline source " + stage.name + " finished");
+}
+
+// --------------------------------------------------------------------------------------
+
+void Pipeline::runStage (size_t stageIndex, std::stop_token stopToken) {
+    /**
+     * Stage thread body. Runs until stopped, or until the previous stage is done 
+     * and the input queue has drained.
+    */
+
+    Stage &stage = *stages[stageIndex];
+    Stage &previous = *stages[stageIndex - 1];
+    PipelineQueue &next = outputOf(stageIndex);
+    
+    while (!stopToken.stop_requested()) {
+        PipelineItem item;
+        if (!stage.input->pop(item, stopToken, 0.05)) {
+            if (previous.done && stage.input->size() == 0) {
+                break;
+            }
+            continue;
+        }
+        
+        {
+            const std::lock_guard<std::mutex> lock (stage.stats_mutex);
+            stage.occupancy.add(stage.input->size() + 1);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool kept = stage.function(*item);
+        record(stage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), kept);
+        
+        if (kept) {
+            next.push(std::move(item), stopToken);
+        }
+    }
+    
+    stage.done = true;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool Pipeline::pop (PipelineItem &item, double timeoutSeconds) {
+    /**
+     * Get the next frame out of the last stage
+     * @param item - receives the frame
+     * @param timeoutSeconds - how long to wait
+     * @returns false on timeout or once the pipeline has finished
+    */
+
+    if (!output->pop(item, std::stop_token(), timeoutSeconds)) {
+        return false;
+    }
+
+    const std::lock_guard<std::mutex> lock (output_mutex);
+    output_latency.add(item->metadata.ageMilliseconds());
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool Pipeline::finished () {
+    /**
+     * Returns true once every stage has stopped and the output queue is empty
+    */
+
+    return !stages.empty() && stages.back()->done && output->size() == 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::vector<StageStats> Pipeline::getStats () {
+    
+    std::vector<StageStats> all_stats;
+    for (auto &stage : stages) {
+        StageStats stats;
+        stats.name = stage->name;
+        if (stage->input) {
+            stats.queue_dropped = stage->input->getDropped();
+            stats.queue_capacity = stage->input->capacity();
+        }
+
+        const std::lock_guard<std::mutex> lock (stage->stats_mutex);
+        stats.processed = stage->processed;
+        stats.discarded = stage->discarded;
+        stats.mean_occupancy = stage->occupancy.mean();
+        stats.mean_ms = stage->latency.mean();
+        stats.max_ms = stage->latency.max();
+        all_stats.push_back(stats);
+    }
+    return all_stats;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string Pipeline::printStats () {
+    /**
+     * One line per stage plus the end to end latency at the output
+    */
+
+    std::ostringstream oss;
+    for (auto &stats : getStats()) {
+        oss << stats.name << ": processed " << stats.processed << ", discarded " << stats.discarded 
+            << ", " << stats.mean_ms << "ms (max " << stats.max_ms << "ms)";
+        if (stats.queue_capacity > 0) {
+            oss << ", queue " << stats.mean_occupancy << "/" << stats.queue_capacity 
+                << " dropped " << stats.queue_dropped;
+        }
+        oss << std::endl;
+    }
+
+    const std::lock_guard<std::mutex> lock (output_mutex);
+    oss << "output: dropped " << output->getDropped() << ", glass to output " << output_latency.mean() 
+        << "ms (max " << output_latency.max() << "ms)";
+    return oss.str();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "boundedqueue.hpp"
+#include "detector.hpp"
+#include "dualstreamframe.hpp"
+#include "framemetadata.hpp"
+#include "frameproducts.hpp"
+
+/**
+ * Everything the pipeline knows about one frame. Items are recycled by the source
+ * once no stage holds them, so the members keep their buffers from frame to frame.
+*/
+struct PipelineFrame {
+    std::shared_ptr<DualStreamFrame> dual = std::make_shared<DualStreamFrame>();
+    std::shared_ptr<FrameProducts> products = std::make_shared<FrameProducts>();
+    FrameMetadata metadata;
+    bool detect = true;
+    Detections detections;
+    std::vector<int> track_ids;
+    int target = -1;
+    cv::Point target_center;
+
+    void reset ();
+};
+
+typedef std::shared_ptr<PipelineFrame> PipelineItem;
+typedef BoundedQueue<PipelineItem> PipelineQueue;
+
+/**
+ * A stage's work on one frame. The source returns false at the end of the stream; 
+ * any other stage returns false to drop the frame.
+*/
+typedef std::function<bool (PipelineFrame &)> StageFunction;
+
+struct StageStats {
+    std::string name;
+    uint64_t processed = 0;
+    uint64_t discarded = 0;
+    uint64_t queue_dropped = 0;
+    size_t queue_capacity = 0;
+    double mean_occupancy = 0.0;
+    double mean_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+/**
+ * A chain of stages, each on its own thread, connected by bounded lock free queues.
+ * Latency becomes the slowest stage rather than the sum of all of them. The last 
+ * stage feeds an output queue read with pop(), normally by the display on the main thread.
+*/
+class Pipeline {
+    public:
+        Pipeline ();
+        ~Pipeline ();
+        void setSource (std::string, StageFunction);
+        void addStage (std::string, StageFunction, size_t = 2, QueuePolicy = QueuePolicy::DROP_OLDEST);
+        void setOutput (size_t = 2, QueuePolicy = QueuePolicy::DROP_OLDEST);
+        size_t getItemCount ();
+        void start ();
+        void stop ();
+        bool pop (PipelineItem &, double = 0.1);
+        bool finished ();
+        std::vector<StageStats> getStats ();
+        std::string printStats ();
+
+    protected:
+        struct Stage {
+            std::string name;
+            StageFunction function;
+            std::unique_ptr<PipelineQueue> input;
+            std::mutex stats_mutex;
+            RollingStat latency;
+            RollingStat occupancy;
+            uint64_t processed = 0;
+            uint64_t discarded = 0;
+            std::atomic<bool> done = false;
+            std::jthread thread;
+        };
+
+        void runSource (std::stop_token);
+        void runStage (size_t, std::stop_token);
+        PipelineQueue& outputOf (size_t);
+        PipelineItem acquireItem ();
+        void record (Stage &, double, bool);
+
+        std::vector<std::unique_ptr<Stage>> stages;
+        std::unique_ptr<PipelineQueue> output;
+        std::vector<PipelineItem> items;
+        std::mutex output_mutex;
+        RollingStat output_latency;
+};
@@ -0,0 +1,309 @@
+#include "proposaldetector.hpp"
+
+
+ProposalDetector::ProposalDetector (Detector &fullDetector, Detector &cropDetector, double fullInterval,
+    int grayLevel, int maxCrops) : full_detector(fullDetector), crop_detector(cropDetector) {
+
+    /**
+     * @param fullDetector - detector for the whole frame
+     * @param cropDetector - detector for the crops, normally with a smaller input
+     * @param fullInterval - longest time in seconds between full frame detections
+     * @param grayLevel - pyramid level the background is modelled at
+     * @param maxCrops - most crops worth running before the full frame is cheaper
+    */
+
+    full_interval = fullInterval;
+    level = grayLevel;
+    max_crops = maxCrops;
+    min_area = 20;
+    packer = nullptr;
+    relearn = false;
+    learned = false;
+
+    // About ten seconds of frames at 30fps. Shadows would only add blobs around real ones
+    background = cv::createBackgroundSubtractorMOG2(300, 25, false);
+}
+
+// --------------------------------------------------------------------------------------
+
+void ProposalDetector::detect (const cv::Mat &frame, Detections &detections) {
+    /**
+     * Without the frame's products there's no shared gray level to model, so detect
+     * on the full frame
+    */
+
+    full_detector.detect(frame, detections);
+}
+
+// --------------------------------------------------------------------------------------
+
+void ProposalDetector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Detect on crops around the moving regions, or on the full frame when that's due
+     * @param products - the frame's shared products
+     * @param detections - boxes in frame coordinates
+    */
+
+    stats.frames++;
+    auto grab_time = products.metadata().grab_time;
+
+    // While the camera moves every pixel is foreground
+    if (servo_activity && servo_activity(grab_time)) {
+        stats.servo_full++;
+        runFull(products, grab_time, detections);
+        return;
+    }
+    if (!takeForeground(products, foreground)) {
+        stats.unmodelled_full++;
+        runFull(products, grab_time, detections);
+        return;
+    }
+
+    if (std::chrono::duration<double>(grab_time - last_full).count() >= full_interval) {
+        stats.periodic_full++;
+        runFull(products, grab_time, detections);
+        return;
+    }
+
+    cv::Mat frame = products.frame();
+    propose(foreground, frame.size(), (double)frame.cols / foreground.cols);
+    int cropped = 0;
+    for (auto &crop : proposals) {
+        cropped += crop.area();
+    }
+    if (proposals.size() > max_crops || cropped > frame.size().area() / 2) {
+        stats.busy_full++;
+        runFull(products, grab_time, detections);
+        return;
+    }
+
+    detections.clear();
+    if (proposals.empty()) {
+        stats.empty_frames++;
+        return;
+    }
+    if (packer && proposals.size() > 1) {
+        crops.clear();
+        for (auto &crop : proposals) {
+            crops.push_back(frame(crop));
+        }
+        packer->detect(crops, packed_detections);
+        // The crops are views of the frame, which mustn't be kept from its pool
+        crops.clear();
+        for (size_t c=0; c<proposals.size(); c++) {
+            Detections &found = packed_detections[c];
+            for (size_t i=0; i<found.size(); i++) {
+                detections.add(found.class_ids[i], found.confidences[i], found.boxes[i] + proposals[c].tl());
+            }
+        }
+        stats.packed_frames++;
+    }
+    else {
+        for (auto &crop : proposals) {
+            crop_detector.detect(frame(crop), crop_detections);
+            for (size_t i=0; i<crop_detections.size(); i++) {
+                detections.add(crop_detections.class_ids[i], crop_detections.confidences[i], crop_detections.boxes[i] + crop.tl());
+            }
+        }
+    }
+    stats.proposal_frames++;
+    stats.crops += proposals.size();
+}
+
+// --------------------------------------------------------------------------------------
+
+void ProposalDetector::learn (FrameProducts &products) {
+    /**
+     * Update the background with a frame and keep its foreground for detect().
+     * Call it for every frame, in grab order, whether or not it's detected on.
+     * @param products - the frame's shared products
+    */
+
+    cv::Mat mask;
+    const std::lock_guard<std::mutex> lock (background_mutex);
+    learned = true;
+    if (!learnLocked(products, mask)) {
+        return;
+    }
+    // Frames dropped before detection leave their masks behind
+    while (foregrounds.size() >= 16) {
+        foregrounds.pop_front();
+    }
+    foregrounds.emplace_back(products.metadata().grab_time, mask);
+}
+
+// --------------------------------------------------------------------------------------
+
+bool ProposalDetector::learnLocked (FrameProducts &products, cv::Mat &mask) {
+    /**
+     * Apply a frame to the background model. The background mutex must be held.
+     * @param mask - the frame's foreground at the modelled level
+     * @returns false while the servos move, when there's no usable foreground
+    */
+
+    // While the camera moves every pixel is foreground, so relearn once it stops
+    if (servo_activity && servo_activity(products.metadata().grab_time)) {
+        relearn = true;
+        return false;
+    }
+    background->apply(products.gray(level), mask, relearn ? 1.0 : -1.0);
+    relearn = false;
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool ProposalDetector::takeForeground (FrameProducts &products, cv::Mat &mask) {
+    /**
+     * Get the foreground learn() computed for a frame, or learn from the frame here
+     * when nothing calls learn()
+     * @returns false if there's no foreground for the frame
+    */
+
+    const std::lock_guard<std::mutex> lock (background_mutex);
+    if (!learned) {
+        return learnLocked(products, mask);
+    }
+    auto grab_time = products.metadata().grab_time;
+    while (!foregrounds.empty() && foregrounds.front().first < grab_time) {
+        foregrounds.pop_front();
+    }
+    if (foregrounds.empty() || foregrounds.front().first != grab_time) {
+        return false;
+    }
+    mask = foregrounds.front().second;
+    foregrounds.pop_front();
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size ProposalDetector::getInputSize () {
+
+    return full_detector.getInputSize();
+}
+
+// --------------------------------------------------------------------------------------
+
+void ProposalDetector::setServoActivity (ServoActivity servoActivity) {
+
+    servo_activity = servoActivity;
+}
+
+// --------------------------------------------------------------------------------------
+
+void ProposalDetector::setMinArea (int minArea) {
+    /**
+     * @param minArea - fewest foreground pixels, at the modelled level, a region needs
+    */
+
+    min_area = minArea;
+}
+
+// --------------------------------------------------------------------------------------
+
+void ProposalDetector::setPacker (MosaicPacker *mosaicPacker) {
+    /**
+     * @param mosaicPacker - packer for frames with more than one crop, nullptr to detect on each
+    */
+
+    packer = mosaicPacker;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::vector<cv::Rect> ProposalDetector::getProposals () {
+    /**
+     * The crops detected on for the last frame, in frame coordinates
+    */
+
+    return proposals;
+}
+
+// --------------------------------------------------------------------------------------
+
+ProposalStats ProposalDetector::getStats () {
+
+    return stats;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string ProposalDetector::printStats () {
+
+    std::ostringstream oss;
+    oss << stats.frames << " frames, proposals: " << stats.proposal_frames << " frames with " << stats.crops
+        << " crops, " << stats.packed_frames << " packed, empty: " << stats.empty_frames << ", full: " << stats.periodic_full << " periodic, "
+        << stats.servo_full << " servo, " << stats.busy_full << " busy, " << stats.unmodelled_full << " unmodelled";
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+void ProposalDetector::propose (cv::Mat &mask, cv::Size frameSize, double scale) {
+    /**
+     * Turn the foreground mask into crops. Specks are opened away and the parts of
+     * one object dilated together, then each large enough region gets a crop around
+     * it, and crops that overlap are joined.
+     * @param mask - foreground at the modelled level
+     * @param frameSize - size of the full frame
+     * @param scale - frame pixels per mask pixel
+    */
+
+    cv::morphologyEx(mask, mask, cv::MORPH_OPEN, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
+    cv::dilate(mask, mask, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5)));
+    int count = cv::connectedComponentsWithStats(mask, labels, components, centroids, 8, CV_32S);
+
+    proposals.clear();
+    for (int i=1; i<count; i++) {
+        if (components.at<int>(i, cv::CC_STAT_AREA) < min_area) {
+            continue;
+        }
+        cv::Rect region (components.at<int>(i, cv::CC_STAT_LEFT), components.at<int>(i, cv::CC_STAT_TOP),
+            components.at<int>(i, cv::CC_STAT_WIDTH), components.at<int>(i, cv::CC_STAT_HEIGHT));
+        cv::Rect scaled (cvRound(region.x * scale), cvRound(region.y * scale),
+            cvRound(region.width * scale), cvRound(region.height * scale));
+        proposals.push_back(cropAround(scaled, frameSize));
+    }
+
+    bool joined = true;
+    while (joined) {
+        joined = false;
+        for (size_t i=0; i<proposals.size() && !joined; i++) {
+            for (size_t j=i+1; j<proposals.size() && !joined; j++) {
+                if ((proposals[i] & proposals[j]).area() > 0) {
+                    proposals[i] |= proposals[j];
+                    proposals.erase(proposals.begin() + j);
+                    joined = true;
+                }
+            }
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect ProposalDetector::cropAround (cv::Rect region, cv::Size frameSize) {
+    /**
+     * A square around a region with room for the object's full extent, no smaller than
+     * the crop detector's input, moved inside the frame
+    */
+
+    cv::Size input = crop_detector.getInputSize();
+    int side = std::max({region.width * 3 / 2, region.height * 3 / 2, input.width, input.height});
+    int width = std::min(side, frameSize.width);
+    int height = std::min(side, frameSize.height);
+    cv::Point center = region.tl() + cv::Point(region.width / 2, region.height / 2);
+    int x = std::clamp(center.x - width / 2, 0, frameSize.width - width);
+    int y = std::clamp(center.y - height / 2, 0, frameSize.height - height);
+    return cv::Rect(x, y, width, height);
+}
+
+// --------------------------------------------------------------------------------------
+
+void ProposalDetector::runFull (FrameProducts &products, std::chrono::steady_clock::time_point grabTime, Detections &detections) {
+
+    proposals.clear();
+    full_detector.detect(products, detections);
+    last_full = grabTime;
+}
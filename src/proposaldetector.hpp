@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "detector.hpp"
+#include "mosaicpacker.hpp"
+#include "motion.hpp"
+
+struct ProposalStats {
+    uint64_t frames = 0;
+    uint64_t proposal_frames = 0;
+    uint64_t empty_frames = 0;
+    uint64_t crops = 0;
+    uint64_t packed_frames = 0;
+    uint64_t periodic_full = 0;
+    uint64_t servo_full = 0;
+    uint64_t unmodelled_full = 0;
+    uint64_t busy_full = 0;
+};
+
+/**
+ * Finds the regions where anything moves with a MOG2 background model on a small
+ * grayscale pyramid level, and runs the crop detector only on crops around them.
+ * A frame with no foreground isn't detected on at all. The full detector runs on
+ * the whole frame every fullInterval seconds, so a target that stands still long
+ * enough to become background is still found, while the servos move, since the
+ * whole image shifts, and when too much of the frame is moving for crops to pay.
+ * With a MosaicPacker, several crops are packed into one canvas and cost one inference.
+ * The background has to see every frame, including those a motion gate keeps from
+ * the detector, or a still scene would barely be learned, so learn() is called for
+ * each frame ahead of the gate and detect() picks up that frame's foreground. Without
+ * learn() calls, detect() models the frames it's given itself.
+*/
+class ProposalDetector: public Detector {
+    public:
+        ProposalDetector (Detector &, Detector &, double = 2.0, int = 2, int = 4);
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        void learn (FrameProducts &);
+        cv::Size getInputSize ();
+        void setServoActivity (ServoActivity);
+        void setMinArea (int);
+        void setPacker (MosaicPacker *);
+        std::vector<cv::Rect> getProposals ();
+        ProposalStats getStats ();
+        std::string printStats ();
+
+    protected:
+        bool learnLocked (FrameProducts &, cv::Mat &);
+        bool takeForeground (FrameProducts &, cv::Mat &);
+        void propose (cv::Mat &, cv::Size, double);
+        cv::Rect cropAround (cv::Rect, cv::Size);
+        void runFull (FrameProducts &, std::chrono::steady_clock::time_point, Detections &);
+
+        Detector &full_detector;
+        Detector &crop_detector;
+        double full_interval;
+        int level;
+        size_t max_crops;
+        int min_area;
+        ServoActivity servo_activity;
+        MosaicPacker *packer;
+
+        std::mutex background_mutex;
+        cv::Ptr<cv::BackgroundSubtractorMOG2> background;
+        bool relearn;
+        bool learned;
+        std::deque<std::pair<std::chrono::steady_clock::time_point, cv::Mat>> foregrounds;
+        cv::Mat foreground;
+        cv::Mat labels;
+        cv::Mat components;
+        cv::Mat centroids;
+        std::vector<cv::Rect> proposals;
+        Detections crop_detections;
+        std::vector<cv::Mat> crops;
+        std::vector<Detections> packed_detections;
+        std::chrono::steady_clock::time_point last_full;
+        ProposalStats stats;
+};
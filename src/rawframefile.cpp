@@ -0,0 +1,273 @@
+#include "rawframefile.hpp"
+
+
+RawFrameRecorder::RawFrameRecorder () {
+    
+    std::memset(&header, 0, sizeof header);
+    write_offset = 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+RawFrameRecorder::~RawFrameRecorder () {
+    close();
+}
+
+// --------------------------------------------------------------------------------------
+
+void RawFrameRecorder::open (std::string filename) {
+    /**
+     * Create the file and reserve space for the header
+     * @param filename - file to write
+     * @throws runtime_error if the file cannot be created
+    */
+
+    close();
+    file.open(filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to create: " + filename);
+    }
+
+    std::memset(&header, 0, sizeof header);
+    std::memcpy(header.magic, RAW_FRAME_MAGIC, sizeof header.magic);
+    header.version = RAW_FRAME_VERSION;
+    index.clear();
+    
+    writeHeader();
+    write_offset = RAW_FRAME_ALIGNMENT;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool RawFrameRecorder::write (const cv::Mat &frame, double timestampMs) {
+    /**
+     * Append a frame to the file
+     * @param frame - frame to write. Must match the size and type of the first frame.
+     * @param timestampMs - capture time of the frame in milliseconds
+     * @returns false if the recorder is closed or the frame doesn't match
+    */
+
+    if (!file.is_open() || frame.empty()) {
+        return false;
+    }
+
+    if (index.empty()) {
+        header.rows = frame.rows;
+        header.cols = frame.cols;
+        header.type = frame.type();
+        header.frame_bytes = frame.total() * frame.elemSize();
+    }
+    else if (frame.rows != header.rows || frame.cols != header.cols || frame.type() != header.type) {
+        spdlog::warn("Raw recorder skipping frame with different size or type");
+        return false;
+    }
+
+    file.seekp(write_offset);
+    if (frame.isContinuous()) {
+        file.write((const char*)frame.data, header.frame_bytes);
+    }
+    else {
+        for (int row=0; row<frame.rows; row++) {
+            file.write((const char*)frame.ptr(row), frame.cols * frame.elemSize());
+        }
+    }
+
+    index.push_back(RawFrameIndexEntry{write_offset, timestampMs});
+    write_offset += (header.frame_bytes + RAW_FRAME_ALIGNMENT - 1) / RAW_FRAME_ALIGNMENT * RAW_FRAME_ALIGNMENT;
+    return file.good();
+}
+
+// --------------------------------------------------------------------------------------
+
+void RawFrameRecorder::close () {
+    /**
+     * Write the index after the last frame, then rewrite the header to point at it
+    */
+
+    if (!file.is_open()) {
+        return;
+    }
+
+    header.frame_count = index.size();
+    header.index_offset = write_offset;
+    file.seekp(write_offset);
+    file.write((const char*)index.data(), index.size() * sizeof(RawFrameIndexEntry));
+    writeHeader();
+    file.close();
+}
+
+// --------------------------------------------------------------------------------------
+
+void RawFrameRecorder::writeHeader () {
+    /**
+     * Write the header padded out to the alignment
+    */
+
+    std::vector<char> block(RAW_FRAME_ALIGNMENT, 0);
+    std::memcpy(block.data(), &header, sizeof header);
+    file.seekp(0);
+    file.write(block.data(), block.size());
+}
+
+// --------------------------------------------------------------------------------------
+
+bool RawFrameRecorder::isOpen () {
+    
+    return file.is_open();
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t RawFrameRecorder::getFrameCount () {
+    
+    return index.size();
+}
+
+// ======================================================================================
+
+RawCaptureManager::RawCaptureManager () {
+    
+    std::memset(&header, 0, sizeof header);
+    index = nullptr;
+    position = 0;
+    loop = false;
+}
+
+// --------------------------------------------------------------------------------------
+
+RawCaptureManager::~RawCaptureManager () {
+    close();
+}
+
+// --------------------------------------------------------------------------------------
+
+int RawCaptureManager::open (std::string filename) {
+    /**
+     * Map a raw frame file and validate its header and index
+     * @param filename - file written by RawFrameRecorder
+     * @returns 0, throws if the file is missing or malformed
+    */
+
+    mapped_file.open(filename);
+    if (mapped_file.size() < sizeof header) {
+        close();
+        throw std::runtime_error("Raw frame file too small: " + filename);
+    }
+    
+    std::memcpy(&header, mapped_file.data(), sizeof header);
+    if (std::memcmp(header.magic, RAW_FRAME_MAGIC, sizeof header.magic) != 0 || header.version != RAW_FRAME_VERSION) {
+        close();
+        throw std::runtime_error("Not a raw frame file: " + filename);
+    }
+    
+    // Compared without adding or multiplying header fields, so a corrupt header can't overflow past the checks
+    if (header.index_offset > mapped_file.size()
+        || header.frame_count > (mapped_file.size() - header.index_offset) / sizeof(RawFrameIndexEntry)) {
+        close();
+        throw std::runtime_error("Raw frame file is truncated: " + filename);
+    }
+
+    // Frames are returned as Mats of rows x cols x type, which must be exactly frame_bytes
+    if (header.rows <= 0 || header.cols <= 0 || header.type != CV_MAT_TYPE(header.type)
+        || header.frame_bytes % CV_ELEM_SIZE(header.type) != 0
+        || header.frame_bytes / CV_ELEM_SIZE(header.type) != (uint64_t)header.rows * header.cols) {
+        close();
+        throw std::runtime_error("Raw frame file has an inconsistent frame size: " + filename);
+    }
+
+    index = (const RawFrameIndexEntry*)(mapped_file.data() + header.index_offset);
+    position = 0;
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool RawCaptureManager::read (cv::OutputArray& frameOut) {
+    /**
+     * Return the next frame as a header over the mapped file
+     * @param frameOut - set to the next frame
+     * @returns false after the last frame unless looping, or at a frame outside the file
+    */
+
+    if (position >= getFrameCount()) {
+        if (!loop || getFrameCount() == 0) {
+            return false;
+        }
+        position = 0;
+    }
+
+    cv::Mat next = frame(position++);
+    if (next.empty()) {
+        spdlog::error("Raw frame " + std::to_string(position - 1) + " lies outside the file");
+        return false;
+    }
+    frameOut.assign(next);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool RawCaptureManager::read (cv::OutputArray& frameOut, FrameMetadata& metadata) {
+    /**
+     * Return the next frame, using the recorded timestamp as the driver timestamp
+    */
+
+    if (!CaptureManager::read(frameOut, metadata)) {
+        return false;
+    }
+    metadata.driver_timestamp = timestamp(position - 1);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Mat RawCaptureManager::frame (uint64_t frameIndex) {
+    /**
+     * Get a frame by index without copying
+     * @param frameIndex - index of the frame
+     * @returns Mat header over the mapped frame, empty if the index is out of range
+    */
+
+    if (frameIndex >= getFrameCount() || index[frameIndex].offset > mapped_file.size()
+        || header.frame_bytes > mapped_file.size() - index[frameIndex].offset) {
+        return cv::Mat();
+    }
+    return cv::Mat(header.rows, header.cols, header.type, mapped_file.data() + index[frameIndex].offset);
+}
+
+// --------------------------------------------------------------------------------------
+
+double RawCaptureManager::timestamp (uint64_t frameIndex) {
+    
+    return frameIndex < getFrameCount() ? index[frameIndex].timestamp : 0.0;
+}
+
+// --------------------------------------------------------------------------------------
+
+uint64_t RawCaptureManager::getFrameCount () {
+    
+    return mapped_file.isOpen() ? header.frame_count : 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void RawCaptureManager::seek (uint64_t frameIndex) {
+    
+    position = frameIndex;
+}
+
+// --------------------------------------------------------------------------------------
+
+void RawCaptureManager::setLoop (bool loopFrames) {
+    
+    loop = loopFrames;
+}
+
+// --------------------------------------------------------------------------------------
+
+void RawCaptureManager::close () {
+    
+    mapped_file.close();
+    index = nullptr;
+    position = 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "capturemanager.hpp"
+#include "mappedfile.hpp"
+
+/**
+ * Layout of a raw frame file:
+ *   header, padded to RAW_FRAME_ALIGNMENT bytes
+ *   frames, each starting on a RAW_FRAME_ALIGNMENT boundary, rows stored contiguously
+ *   index of frame_count RawFrameIndexEntry records starting at index_offset
+ * All frames share the size and type of the first frame written.
+*/
+const char RAW_FRAME_MAGIC[8] = {'R', 'A', 'W', 'F', 'R', 'A', 'M', 'E'};
+const uint32_t RAW_FRAME_VERSION = 1;
+const uint64_t RAW_FRAME_ALIGNMENT = 4096;
+
+struct RawFrameHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint64_t frame_bytes;
+    uint64_t frame_count;
+    uint64_t index_offset;
+};
+
+struct RawFrameIndexEntry {
+    uint64_t offset;
+    double timestamp;
+};
+
+/**
+ * Writes uncompressed frames and their timestamps to a raw frame file
+*/
+class RawFrameRecorder {
+    public:
+        RawFrameRecorder ();
+        ~RawFrameRecorder ();
+        void open (std::string);
+        bool write (const cv::Mat &, double);
+        void close ();
+        bool isOpen ();
+        uint64_t getFrameCount ();
+    protected:
+        void writeHeader ();
+        
+        std::ofstream file;
+        RawFrameHeader header;
+        std::vector<RawFrameIndexEntry> index;
+        uint64_t write_offset;
+};
+
+/**
+ * Replays a raw frame file. The file is memory mapped and each frame is returned
+ * as a cv::Mat header over the mapped pages, so no decode or copy takes place.
+ * Frames stay valid until the manager is closed. Drawing on a frame only changes 
+ * the process's copy of that page, never the file.
+*/
+class RawCaptureManager: public CaptureManager {
+    public:
+        RawCaptureManager ();
+        ~RawCaptureManager ();
+        int open (std::string);
+        bool read (cv::OutputArray&);
+        bool read (cv::OutputArray&, FrameMetadata&);
+        void close (void);
+        cv::Mat frame (uint64_t);
+        double timestamp (uint64_t);
+        uint64_t getFrameCount ();
+        void seek (uint64_t);
+        void setLoop (bool);
+    protected:
+        MappedFile mapped_file;
+        RawFrameHeader header;
+        const RawFrameIndexEntry* index;
+        uint64_t position;
+        bool loop;
+};
@@ -0,0 +1,198 @@
+#include "resolutiongovernor.hpp"
+
+
+ResolutionGovernor::ResolutionGovernor (std::vector<cv::Size> inputSizes, double budgetMs, size_t startIndex,
+    double upFraction, int holdFrames, double smoothingFactor) {
+
+    /**
+     * @param inputSizes - candidate network inputs, sorted from smallest to largest on return
+     * @param budgetMs - inference time per frame to stay within
+     * @param startIndex - index of the size to start at, in the sorted set
+     * @param upFraction - fraction of the budget the next size up must be predicted to fit in
+     * @param holdFrames - frames to hold a size after switching to it
+     * @param smoothingFactor - weight of each new measurement in the moving average
+    */
+
+    CV_Assert(!inputSizes.empty());
+    sizes = inputSizes;
+    std::sort(sizes.begin(), sizes.end(), [] (cv::Size a, cv::Size b) { return a.area() < b.area(); });
+    budget_ms = budgetMs;
+    up_fraction = upFraction;
+    hold_frames = holdFrames;
+    smoothing = smoothingFactor;
+
+    index = std::min(startIndex, sizes.size() - 1);
+    mean_ms = 0.0;
+    since_switch = 0;
+    stats.budget_ms = budget_ms;
+}
+
+// --------------------------------------------------------------------------------------
+
+bool ResolutionGovernor::update (double ms) {
+    /**
+     * Add a measured inference time
+     * @param ms - milliseconds the last inference took at the current size
+     * @returns true if the size changed
+    */
+
+    // The first measurement at a size sets the average rather than blending with the last size's
+    mean_ms = since_switch == 0 ? ms : mean_ms + smoothing * (ms - mean_ms);
+    since_switch++;
+    {
+        const std::lock_guard<std::mutex> lock (stats_mutex);
+        stats.frames++;
+        stats.mean_ms = mean_ms;
+    }
+
+    if (since_switch < hold_frames) {
+        return false;
+    }
+
+    size_t current = index;
+    if (mean_ms > budget_ms && current > 0) {
+        switchTo(current - 1);
+        return true;
+    }
+    if (current + 1 < sizes.size()) {
+        double predicted = mean_ms * sizes[current + 1].area() / sizes[current].area();
+        if (predicted < budget_ms * up_fraction) {
+            switchTo(current + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// --------------------------------------------------------------------------------------
+
+size_t ResolutionGovernor::getIndex () {
+
+    return index;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size ResolutionGovernor::getSize () {
+
+    return sizes[index];
+}
+
+// --------------------------------------------------------------------------------------
+
+std::vector<cv::Size> ResolutionGovernor::getSizes () {
+
+    return sizes;
+}
+
+// --------------------------------------------------------------------------------------
+
+GovernorStats ResolutionGovernor::getStats () {
+
+    const std::lock_guard<std::mutex> lock (stats_mutex);
+    GovernorStats s = stats;
+    s.input_size = sizes[index];
+    s.recent.assign(recent.begin(), recent.end());
+    return s;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string ResolutionGovernor::printStats () {
+    /**
+     * Current size and average, then the most recent switches
+    */
+
+    GovernorStats s = getStats();
+    std::ostringstream oss;
+    oss << "input " << s.input_size.width << "x" << s.input_size.height << ", " << s.mean_ms << "ms of "
+        << s.budget_ms << "ms budget, " << s.frames << " frames, " << s.switches << " switches";
+    auto now = std::chrono::steady_clock::now();
+    for (auto &event : s.recent) {
+        oss << std::endl << "  " << std::chrono::duration<double>(now - event.time).count() << "s ago: "
+            << event.from.width << " -> " << event.to.width << " at " << event.mean_ms << "ms";
+    }
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+void ResolutionGovernor::switchTo (size_t next) {
+
+    ResolutionSwitch event = {std::chrono::steady_clock::now(), sizes[index], sizes[next], mean_ms};
+    spdlog::info("Input size " + std::to_string(event.from.width) + " -> " + std::to_string(event.to.width)
+        + " at " + std::to_string(mean_ms) + "ms");
+
+    index = next;
+    since_switch = 0;
+
+    const std::lock_guard<std::mutex> lock (stats_mutex);
+    stats.switches++;
+    recent.push_back(event);
+    if (recent.size() > 10) {
+        recent.pop_front();
+    }
+}
+
+// ======================================================================================
+
+GovernedDetector::GovernedDetector (ModelCache &model, ResolutionGovernor &resolutionGovernor, int backend, int target)
+    : governor(resolutionGovernor) {
+
+    /**
+     * @param model - model to build the networks from
+     * @param resolutionGovernor - governor choosing between its input sizes
+     * @param backend - cv::dnn backend
+     * @param target - cv::dnn target
+    */
+
+    for (auto size : governor.getSizes()) {
+        detectors.push_back(std::make_unique<YoloDetector>(model.create(backend, target, size), size));
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void GovernedDetector::detect (const cv::Mat &frame, Detections &detections) {
+
+    utils::Timer timer;
+    detectors[governor.getIndex()]->detect(frame, detections);
+    governor.update(timer.seconds() * 1000);
+}
+
+// --------------------------------------------------------------------------------------
+
+void GovernedDetector::detect (FrameProducts &products, Detections &detections) {
+
+    utils::Timer timer;
+    detectors[governor.getIndex()]->detect(products, detections);
+    governor.update(timer.seconds() * 1000);
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size GovernedDetector::getInputSize () {
+    /**
+     * The current input size, which can change after any detection
+    */
+
+    return governor.getSize();
+}
+
+// --------------------------------------------------------------------------------------
+
+void GovernedDetector::setClasses (std::vector<int> classIds) {
+
+    for (auto &detector : detectors) {
+        detector->setClasses(classIds);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void GovernedDetector::setThresholds (float confidenceThreshold, float nmsThreshold) {
+
+    for (auto &detector : detectors) {
+        detector->setThresholds(confidenceThreshold, nmsThreshold);
+    }
+}
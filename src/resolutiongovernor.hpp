@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <spdlog/spdlog.h>
+#include "detector.hpp"
+#include "modelcache.hpp"
+#include "utils.hpp"
+#include "yolodecoder.hpp"
+
+/**
+ * A change of input size and the smoothed inference time that caused it
+*/
+struct ResolutionSwitch {
+    std::chrono::steady_clock::time_point time;
+    cv::Size from;
+    cv::Size to;
+    double mean_ms;
+};
+
+struct GovernorStats {
+    cv::Size input_size;
+    double mean_ms = 0.0;
+    double budget_ms = 0.0;
+    uint64_t frames = 0;
+    uint64_t switches = 0;
+    std::vector<ResolutionSwitch> recent;
+};
+
+/**
+ * Chooses an input size from a set to keep inference within a per frame budget.
+ * Inference time is smoothed with an exponential moving average. The size drops
+ * when the average goes over budget, and rises only when the next size up is
+ * predicted, by scaling with its area, to fit within upFraction of the budget.
+ * After a switch the size is held for holdFrames so the average can settle.
+*/
+class ResolutionGovernor {
+    public:
+        ResolutionGovernor (std::vector<cv::Size>, double, size_t = 0, double = 0.8, int = 30, double = 0.1);
+        bool update (double);
+        size_t getIndex ();
+        cv::Size getSize ();
+        std::vector<cv::Size> getSizes ();
+        GovernorStats getStats ();
+        std::string printStats ();
+
+    protected:
+        void switchTo (size_t);
+
+        std::vector<cv::Size> sizes;
+        double budget_ms;
+        double up_fraction;
+        int hold_frames;
+        double smoothing;
+
+        std::atomic<size_t> index;
+        double mean_ms;
+        int since_switch;
+        std::mutex stats_mutex;
+        GovernorStats stats;
+        std::deque<ResolutionSwitch> recent;
+};
+
+/**
+ * YOLO detector with one network per governed input size, each built and warmed
+ * up front so a switch costs nothing. Each full detection is timed and fed to the governor.
+*/
+class GovernedDetector: public Detector {
+    public:
+        GovernedDetector (ModelCache &, ResolutionGovernor &, int = cv::dnn::DNN_BACKEND_OPENCV, int = cv::dnn::DNN_TARGET_CPU);
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        cv::Size getInputSize ();
+        void setClasses (std::vector<int>);
+        void setThresholds (float, float);
+
+    protected:
+        ResolutionGovernor &governor;
+        std::vector<std::unique_ptr<YoloDetector>> detectors;
+};
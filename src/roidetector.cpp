@@ -0,0 +1,190 @@
+#include "roidetector.hpp"
+
+
+RoiDetector::RoiDetector (Detector &fullDetector, Detector &windowDetector, int targetClass, float windowScale, int maxMisses)
+    : detector(fullDetector), window_detector(windowDetector) {
+
+    /**
+     * @param fullDetector - detector run on the whole frame
+     * @param windowDetector - detector run on the search window, may be the same one
+     * @param targetClass - class whose last box the window follows
+     * @param windowScale - window side as a multiple of the last box's longer side
+     * @param maxMisses - windows in a row without the target before searching the full frame
+    */
+
+    target_class = targetClass;
+    window_scale = windowScale;
+    max_misses = std::max(maxMisses, 1);
+
+    // Smaller windows would be upscaled to the input, which costs the same and sees less
+    min_window = window_detector.getInputSize().width;
+    reset();
+}
+
+// --------------------------------------------------------------------------------------
+
+void RoiDetector::detect (const cv::Mat &frame, Detections &detections) {
+
+    step(frame, std::chrono::steady_clock::now(), detections, [&] (Detections &all) { detector.detect(frame, all); });
+}
+
+// --------------------------------------------------------------------------------------
+
+void RoiDetector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Full frame searches use the wrapped detector's shared products path
+    */
+
+    step(products.frame(), products.metadata().grab_time, detections, [&] (Detections &all) { detector.detect(products, all); });
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size RoiDetector::getInputSize () {
+
+    return detector.getInputSize();
+}
+
+// --------------------------------------------------------------------------------------
+
+void RoiDetector::follow (cv::Rect box, std::chrono::steady_clock::time_point grabTime) {
+    /**
+     * Move the window to a target location found elsewhere, e.g. by a tracker
+     * @param box - target box in frame coordinates
+     * @param grabTime - grab time of the frame it was found in
+    */
+
+    found = true;
+    misses = 0;
+    last_box = box;
+    last_time = grabTime;
+}
+
+// --------------------------------------------------------------------------------------
+
+void RoiDetector::setCameraMotion (CameraMotion cameraMotion) {
+    /**
+     * @param cameraMotion - predicts the image shift caused by our own pan/tilt moves
+    */
+
+    camera_motion = cameraMotion;
+}
+
+// --------------------------------------------------------------------------------------
+
+void RoiDetector::setMinWindow (int side) {
+
+    min_window = side;
+}
+
+// --------------------------------------------------------------------------------------
+
+void RoiDetector::reset () {
+    /**
+     * Forget the target and search the full frame
+    */
+
+    found = false;
+    misses = 0;
+    last_box = cv::Rect();
+    window = cv::Rect();
+}
+
+// --------------------------------------------------------------------------------------
+
+bool RoiDetector::isSearching () {
+    /**
+     * @returns true while the full frame is searched
+    */
+
+    return !found;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect RoiDetector::getWindow () {
+    /**
+     * @returns the last search window, empty after a full frame search
+    */
+
+    return window;
+}
+
+// --------------------------------------------------------------------------------------
+
+RoiStats RoiDetector::getStats () {
+
+    return stats;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string RoiDetector::printStats () {
+
+    std::ostringstream oss;
+    oss << "roi runs: " << stats.roi_runs << ", full runs: " << stats.full_runs
+        << ", roi misses: " << stats.roi_misses << ", fallbacks: " << stats.fallbacks;
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+void RoiDetector::step (const cv::Mat &frame, std::chrono::steady_clock::time_point grabTime,
+    Detections &detections, const std::function<void (Detections &)> &runFull) {
+
+    /**
+     * Search the window if the target was seen recently, then the full frame if it
+     * has now been missed too many times
+    */
+
+    if (found) {
+        window = predictWindow(frame.size(), grabTime);
+        window_detector.detect(frame(window), detections);
+        for (auto &box : detections.boxes) {
+            box += window.tl();
+        }
+        stats.roi_runs++;
+
+        int target = detections.find(target_class);
+        if (target >= 0) {
+            follow(detections.boxes[target], grabTime);
+            return;
+        }
+
+        stats.roi_misses++;
+        if (++misses < max_misses) {
+            return;
+        }
+        stats.fallbacks++;
+        reset();
+    }
+
+    window = cv::Rect();
+    runFull(detections);
+    stats.full_runs++;
+
+    int target = detections.find(target_class);
+    if (target >= 0) {
+        follow(detections.boxes[target], grabTime);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect RoiDetector::predictWindow (cv::Size frameSize, std::chrono::steady_clock::time_point grabTime) {
+    /**
+     * Square window around the last box, shifted by the camera motion since it was seen
+     * and kept inside the frame
+    */
+
+    cv::Point center = last_box.tl() + cv::Point(last_box.width / 2, last_box.height / 2);
+    if (camera_motion) {
+        center += camera_motion(last_time, grabTime);
+    }
+
+    int side = std::max((int)(std::max(last_box.width, last_box.height) * window_scale), min_window);
+    side = std::min(side, std::min(frameSize.width, frameSize.height));
+    int x = std::clamp(center.x - side / 2, 0, frameSize.width - side);
+    int y = std::clamp(center.y - side / 2, 0, frameSize.height - side);
+    return cv::Rect(x, y, side, side);
+}
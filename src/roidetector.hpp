@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+#include "detector.hpp"
+#include "motion.hpp"
+
+struct RoiStats {
+    uint64_t roi_runs = 0;
+    uint64_t full_runs = 0;
+    uint64_t roi_misses = 0;
+    uint64_t fallbacks = 0;
+};
+
+/**
+ * Once the target is found, runs a detector on a search window around its predicted
+ * location instead of the whole frame. The window is a square a few times the size 
+ * of the last box, moved by any camera motion since that box was seen. Giving the 
+ * window detector a smaller input than the full frame one is where the time is saved.
+ * After maxMisses windows without the target it falls back to full frame search.
+*/
+class RoiDetector: public Detector {
+    public:
+        RoiDetector (Detector &, Detector &, int, float = 3.0, int = 3);
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        cv::Size getInputSize ();
+        void follow (cv::Rect, std::chrono::steady_clock::time_point);
+        void setCameraMotion (CameraMotion);
+        void setMinWindow (int);
+        void reset ();
+        bool isSearching ();
+        cv::Rect getWindow ();
+        RoiStats getStats ();
+        std::string printStats ();
+
+    protected:
+        void step (const cv::Mat &, std::chrono::steady_clock::time_point, Detections &, const std::function<void (Detections &)> &);
+        cv::Rect predictWindow (cv::Size, std::chrono::steady_clock::time_point);
+
+        Detector &detector;
+        Detector &window_detector;
+        int target_class;
+        float window_scale;
+        int max_misses;
+        int min_window;
+        CameraMotion camera_motion;
+
+        bool found;
+        int misses;
+        cv::Rect last_box;
+        std::chrono::steady_clock::time_point last_time;
+        cv::Rect window;
+        RoiStats stats;
+};
@@ -0,0 +1,317 @@
+#include "sorttracker.hpp"
+
+
+SortTrack::SortTrack (int trackId, int classId, float trackConfidence, cv::Rect detected)
+    : id(trackId), class_id(classId), confidence(trackConfidence), filter(8, 4, 0, CV_32F) {
+
+    /**
+     * Start a track at a detected box, with unknown velocity
+    */
+
+    // Constant velocity: each of cx, cy, w, h moves by its velocity every frame
+    cv::setIdentity(filter.transitionMatrix);
+    for (int i=0; i<4; i++) {
+        filter.transitionMatrix.at<float>(i, i + 4) = 1.0f;
+    }
+    filter.measurementMatrix = cv::Mat::zeros(4, 8, CV_32F);
+    for (int i=0; i<4; i++) {
+        filter.measurementMatrix.at<float>(i, i) = 1.0f;
+    }
+
+    // Detector boxes jitter by a few pixels; velocities change slowly
+    cv::setIdentity(filter.processNoiseCov, cv::Scalar::all(1));
+    cv::setIdentity(filter.measurementNoiseCov, cv::Scalar::all(16));
+    cv::setIdentity(filter.errorCovPost, cv::Scalar::all(16));
+    for (int i=4; i<8; i++) {
+        filter.processNoiseCov.at<float>(i, i) = i < 6 ? 0.25f : 0.1f;
+        filter.errorCovPost.at<float>(i, i) = i < 6 ? 400.0f : 100.0f;
+    }
+
+    filter.statePost = cv::Mat::zeros(8, 1, CV_32F);
+    filter.statePost.at<float>(0) = detected.x + detected.width / 2.0f;
+    filter.statePost.at<float>(1) = detected.y + detected.height / 2.0f;
+    filter.statePost.at<float>(2) = (float)detected.width;
+    filter.statePost.at<float>(3) = (float)detected.height;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect SortTrack::predict () {
+    /**
+     * Advance the track a frame
+     * @returns the predicted box
+    */
+
+    // predict also copies the prediction to statePost, so a track that misses carries on from it
+    filter.predict();
+    return box();
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect SortTrack::correct (cv::Rect detected) {
+    /**
+     * Update the predicted state with a matched box
+     * @returns the corrected box
+    */
+
+    cv::Mat measurement = (cv::Mat_<float>(4, 1) << detected.x + detected.width / 2.0f,
+        detected.y + detected.height / 2.0f, (float)detected.width, (float)detected.height);
+    filter.correct(measurement);
+    return box();
+}
+
+// --------------------------------------------------------------------------------------
+
+void SortTrack::shift (cv::Point offset) {
+    /**
+     * Move the track with the image, e.g. when the camera turns
+    */
+
+    filter.statePost.at<float>(0) += offset.x;
+    filter.statePost.at<float>(1) += offset.y;
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Rect SortTrack::box () {
+
+    const cv::Mat &state = filter.statePost;
+    float width = std::max(state.at<float>(2), 1.0f);
+    float height = std::max(state.at<float>(3), 1.0f);
+    return cv::Rect(cvRound(state.at<float>(0) - width / 2), cvRound(state.at<float>(1) - height / 2),
+        cvRound(width), cvRound(height));
+}
+
+// ======================================================================================
+
+SortTracker::SortTracker (int targetClass, int maxMisses, int minHits, float iouThreshold) {
+    /**
+     * @param targetClass - class the locked target is chosen from
+     * @param maxMisses - frames a track survives without a match
+     * @param minHits - matches before a track is reported
+     * @param iouThreshold - least IoU for a box to match a track
+    */
+
+    target_class = targetClass;
+    max_misses = maxMisses;
+    min_hits = minHits;
+    iou_threshold = iouThreshold;
+    next_id = 1;
+    locked_id = -1;
+}
+
+// --------------------------------------------------------------------------------------
+
+int SortTracker::update (const Detections &detections, std::chrono::steady_clock::time_point grabTime,
+    Detections &tracked, std::vector<int> &ids) {
+
+    /**
+     * Predict every track to this frame and match the frame's detections to them
+     * @param detections - this frame's boxes
+     * @param grabTime - grab time of the frame
+     * @param tracked - the confirmed tracks matched in this frame
+     * @param ids - track id of each box in tracked
+     * @returns index of the locked target in tracked, or -1 if it wasn't matched
+    */
+
+    stats.frames++;
+    advance(grabTime);
+    predicted.clear();
+    for (auto &track : tracks) {
+        predicted.push_back(track.box());
+    }
+
+    pairs.clear();
+    for (size_t t=0; t<tracks.size(); t++) {
+        for (size_t d=0; d<detections.size(); d++) {
+            if (tracks[t].class_id != detections.class_ids[d]) {
+                continue;
+            }
+            float overlap = iou(predicted[t], detections.boxes[d]);
+            if (overlap >= iou_threshold) {
+                pairs.emplace_back(overlap, (int)t, (int)d);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [] (const auto &a, const auto &b) { return std::get<0>(a) > std::get<0>(b); });
+
+    std::vector<bool> track_matched (tracks.size(), false);
+    std::vector<bool> detection_matched (detections.size(), false);
+    for (auto &[overlap, t, d] : pairs) {
+        if (track_matched[t] || detection_matched[d]) {
+            continue;
+        }
+        track_matched[t] = detection_matched[d] = true;
+        tracks[t].correct(detections.boxes[d]);
+        tracks[t].confidence = detections.confidences[d];
+        tracks[t].hits++;
+        tracks[t].misses = 0;
+    }
+
+    for (size_t t=0; t<tracks.size(); t++) {
+        if (!track_matched[t]) {
+            tracks[t].misses++;
+        }
+    }
+    size_t before = tracks.size();
+    tracks.erase(std::remove_if(tracks.begin(), tracks.end(),
+        [this] (const SortTrack &track) { return track.misses > max_misses; }), tracks.end());
+    stats.lost += before - tracks.size();
+
+    for (size_t d=0; d<detections.size(); d++) {
+        if (!detection_matched[d]) {
+            tracks.emplace_back(next_id++, detections.class_ids[d], detections.confidences[d], detections.boxes[d]);
+            stats.created++;
+        }
+    }
+
+    lock();
+    return report(tracked, ids);
+}
+
+// --------------------------------------------------------------------------------------
+
+int SortTracker::predict (std::chrono::steady_clock::time_point grabTime, Detections &tracked, std::vector<int> &ids) {
+    /**
+     * Advance every track a frame without detections, for frames the detector skipped.
+     * Tracks don't count it as a miss, and those matched last time are reported.
+     * @param grabTime - grab time of the frame
+     * @returns index of the locked target in tracked, or -1
+    */
+
+    stats.predicted++;
+    advance(grabTime);
+    return report(tracked, ids);
+}
+
+// --------------------------------------------------------------------------------------
+
+void SortTracker::setCameraMotion (CameraMotion cameraMotion) {
+    /**
+     * @param cameraMotion - predicts the image shift caused by the camera's own moves,
+     *        in the coordinates of the detections
+    */
+
+    camera_motion = cameraMotion;
+}
+
+// --------------------------------------------------------------------------------------
+
+int SortTracker::getLockedId () {
+
+    return locked_id;
+}
+
+// --------------------------------------------------------------------------------------
+
+void SortTracker::reset () {
+
+    tracks.clear();
+    locked_id = -1;
+    last_grab = std::chrono::steady_clock::time_point();
+}
+
+// --------------------------------------------------------------------------------------
+
+SortStats SortTracker::getStats () {
+
+    SortStats s = stats;
+    s.active = tracks.size();
+    return s;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string SortTracker::printStats () {
+
+    SortStats s = getStats();
+    std::ostringstream oss;
+    oss << s.frames << " frames, " << s.predicted << " predicted, tracks created: " << s.created
+        << ", lost: " << s.lost << ", active: " << s.active << ", lock changes: " << s.lock_changes;
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+void SortTracker::advance (std::chrono::steady_clock::time_point grabTime) {
+    /**
+     * Move every track by the camera motion since the last frame, then predict it a frame on
+    */
+
+    cv::Point offset;
+    if (camera_motion && last_grab.time_since_epoch().count() > 0) {
+        offset = camera_motion(last_grab, grabTime);
+    }
+    last_grab = grabTime;
+    for (auto &track : tracks) {
+        track.shift(offset);
+        track.predict();
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+int SortTracker::report (Detections &tracked, std::vector<int> &ids) {
+    /**
+     * List the confirmed tracks matched on the last detection frame. Coasting tracks
+     * are kept for matching, but not reported, so nothing aims at a stale position.
+     * @returns index of the locked target, or -1
+    */
+
+    tracked.clear();
+    ids.clear();
+    int locked = -1;
+    for (auto &track : tracks) {
+        if (track.hits < min_hits || track.misses > 0) {
+            continue;
+        }
+        if (track.id == locked_id) {
+            locked = (int)ids.size();
+        }
+        tracked.add(track.class_id, track.confidence, track.box());
+        ids.push_back(track.id);
+    }
+    return locked;
+}
+
+// --------------------------------------------------------------------------------------
+
+void SortTracker::lock () {
+    /**
+     * Keep the locked track while it lives. Otherwise lock the confirmed track of the
+     * target class seen the longest, then the most confident.
+    */
+
+    int best = -1;
+    for (size_t t=0; t<tracks.size(); t++) {
+        const SortTrack &track = tracks[t];
+        if (track.id == locked_id) {
+            return;
+        }
+        if (track.class_id != target_class || track.hits < min_hits) {
+            continue;
+        }
+        if (best < 0 || track.hits > tracks[best].hits
+            || (track.hits == tracks[best].hits && track.confidence > tracks[best].confidence)) {
+            best = (int)t;
+        }
+    }
+
+    int next = best >= 0 ? tracks[best].id : -1;
+    if (next != locked_id) {
+        locked_id = next;
+        if (next >= 0) {
+            stats.lock_changes++;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+float SortTracker::iou (const cv::Rect &a, const cv::Rect &b) {
+
+    int intersection = (a & b).area();
+    int combined = a.area() + b.area() - intersection;
+    return combined > 0 ? (float)intersection / combined : 0.0f;
+}
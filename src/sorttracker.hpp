@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "detector.hpp"
+#include "motion.hpp"
+
+struct SortStats {
+    uint64_t frames = 0;
+    uint64_t predicted = 0;
+    uint64_t created = 0;
+    uint64_t lost = 0;
+    uint64_t lock_changes = 0;
+    size_t active = 0;
+};
+
+/**
+ * One object followed from frame to frame. The Kalman state is the box center and
+ * size with their velocities in pixels per frame.
+*/
+struct SortTrack {
+    int id;
+    int class_id;
+    float confidence;
+    int hits = 1;
+    int misses = 0;
+    cv::KalmanFilter filter;
+
+    SortTrack (int, int, float, cv::Rect);
+    cv::Rect predict ();
+    cv::Rect correct (cv::Rect);
+    void shift (cv::Point);
+    cv::Rect box ();
+};
+
+/**
+ * SORT style multi object tracker. Each frame's boxes are matched to the tracks'
+ * predicted boxes by IoU: every pair of the same class above the threshold is
+ * sorted by IoU and taken greedily, O(n log n) in the number of pairs. Unmatched
+ * boxes start tracks, which are kept through maxMisses frames without a match,
+ * so ids are stable while an object stays in view, but only reported on frames
+ * they matched once confirmed by minHits matches. Tracks are in image coordinates,
+ * so they're moved by any camera motion between frames before matching.
+ * One track of the target class is locked as the target and kept until it's lost,
+ * so two candidates don't make the aim flip between them.
+*/
+class SortTracker {
+    public:
+        SortTracker (int, int = 5, int = 2, float = 0.3);
+        int update (const Detections &, std::chrono::steady_clock::time_point, Detections &, std::vector<int> &);
+        int predict (std::chrono::steady_clock::time_point, Detections &, std::vector<int> &);
+        void setCameraMotion (CameraMotion);
+        int getLockedId ();
+        void reset ();
+        SortStats getStats ();
+        std::string printStats ();
+
+    protected:
+        void advance (std::chrono::steady_clock::time_point);
+        int report (Detections &, std::vector<int> &);
+        void lock ();
+        static float iou (const cv::Rect &, const cv::Rect &);
+
+        int target_class;
+        int max_misses;
+        int min_hits;
+        float iou_threshold;
+        CameraMotion camera_motion;
+        std::chrono::steady_clock::time_point last_grab;
+        std::vector<SortTrack> tracks;
+        std::vector<cv::Rect> predicted;
+        std::vector<std::tuple<float, int, int>> pairs;
+        int next_id;
+        int locked_id;
+        SortStats stats;
+};
@@ -0,0 +1,207 @@
+#include "threadedcapturemanager.hpp"
+
+
+ThreadedCaptureManager::ThreadedCaptureManager (void) {
+    
+    frame_ready = false;
+    running = false;
+    read_timeout = std::chrono::milliseconds(2000);
+    frame_pool = nullptr;
+}
+
+// -------------------------------------------------------------------------
+
+ThreadedCaptureManager::~ThreadedCaptureManager () {
+    close();
+}
+
+// -------------------------------------------------------------------------
+
+int ThreadedCaptureManager::open (int source, int api) {
+    /**
+     * Open the camera with the default properties and start the grab thread
+     * @param source - camera index
+     * @param api - capture api
+     * @returns 0, throws if the camera could not be opened
+    */
+
+    CameraCaptureManager::open(source, api);
+
+    // cv::VideoCapture isn't thread safe, so read the properties before the grab thread owns it
+    opened_properties = CameraCaptureManager::getProperties();
+    
+    running = true;
+    grab_thread = std::jthread([this] (std::stop_token stopToken) { grabLoop(stopToken); });
+    return 0;
+}
+
+// -------------------------------------------------------------------------
+
+properties ThreadedCaptureManager::getProperties () {
+    /**
+     * The properties read when the camera was opened. Once the grab thread runs it's
+     * the only user of the capture, so they aren't read from the camera again.
+    */
+
+    if (!grab_thread.joinable()) {
+        return CameraCaptureManager::getProperties();
+    }
+    return opened_properties;
+}
+
+// -------------------------------------------------------------------------
+
+void ThreadedCaptureManager::grabLoop (std::stop_token stopToken) {
+    /**
+     * Thread body. Reads frames as fast as the camera delivers them and publishes 
+     * the newest one. An unconsumed frame is counted as dropped and its buffer is 
+     * reused for the next grab, unless a frame pool supplies the buffers.
+     * @param stopToken - set by close() to end the loop
+    */
+
+    cv::Mat grab_frame;
+    FrameMetadata grab_metadata;
+    
+    while (!stopToken.stop_requested()) {
+        FramePool* pool = frame_pool;
+        if (pool) {
+            grab_frame = pool->acquire();
+        }
+        
+        if (!CameraCaptureManager::read(grab_frame, grab_metadata)) {
+            spdlog::error("Grab thread failed to read a frame");
+            break;
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock (frame_mutex);
+            if (pool && !pool->owns(grab_frame)) {
+                stats.unpooled++;
+            }
+            if (frame_ready) {
+                stats.dropped++;
+            }
+            cv::swap(grab_frame, latest_frame);
+            latest_metadata = grab_metadata;
+            latest_encoded = CameraCaptureManager::getEncoded();
+            frame_ready = true;
+            stats.grabbed++;
+        }
+        frame_cond.notify_one();
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock (frame_mutex);
+        running = false;
+    }
+    frame_cond.notify_all();
+}
+
+// -------------------------------------------------------------------------
+
+bool ThreadedCaptureManager::read (cv::OutputArray& frame) {
+    FrameMetadata metadata;
+    return read(frame, metadata);
+}
+
+// -------------------------------------------------------------------------
+
+bool ThreadedCaptureManager::read (cv::OutputArray& frame, FrameMetadata& metadata) {
+    /**
+     * Wait for a frame newer than the last one delivered and hand it to the caller
+     * without copying.
+     * @param frame - filled with the newest frame
+     * @param metadata - filled with the frame's capture metadata
+     * @returns false if the grab thread has stopped or no frame arrived within the timeout
+    */
+
+    cv::Mat newest;
+    {
+        std::unique_lock<std::mutex> lock (frame_mutex);
+        frame_cond.wait_for(lock, read_timeout, [this] { return frame_ready || !running; });
+        if (!frame_ready) {
+            return false;
+        }
+        
+        cv::swap(newest, latest_frame);
+        metadata = latest_metadata;
+        delivered_encoded = latest_encoded;
+        frame_ready = false;
+        stats.delivered++;
+    }
+
+    frame.assign(newest);
+    return true;
+}
+
+// -------------------------------------------------------------------------
+
+void ThreadedCaptureManager::close () {
+    /**
+     * Stop the grab thread before releasing the camera
+    */
+
+    if (grab_thread.joinable()) {
+        grab_thread.request_stop();
+        grab_thread.join();
+    }
+    CaptureManager::close();
+}
+
+// -------------------------------------------------------------------------
+
+void ThreadedCaptureManager::setReadTimeout (double seconds) {
+    /**
+     * Set how long read() waits for a new frame before giving up
+     * @param seconds - timeout in seconds
+    */
+
+    read_timeout = std::chrono::milliseconds((long)(seconds * 1000));
+}
+
+// -------------------------------------------------------------------------
+
+void ThreadedCaptureManager::setFramePool (FramePool *pool) {
+    /**
+     * Decode frames into buffers from the given pool instead of allocating new ones. 
+     * The pool must hold 3 buffers for the grab thread (latest, the one being replaced
+     * and the one being decoded into) plus one for every frame the consumer keeps, e.g.
+     * Pipeline::getItemCount(), and must outlive the capture manager.
+     * @param pool - pool to use, or nullptr to stop using one
+    */
+
+    frame_pool = pool;
+}
+
+// -------------------------------------------------------------------------
+
+cv::Mat ThreadedCaptureManager::getEncoded () {
+    /**
+     * Compressed buffer of the frame last delivered by read(), in reduced decode mode
+    */
+
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return delivered_encoded;
+}
+
+// -------------------------------------------------------------------------
+
+CaptureStats ThreadedCaptureManager::getStats () {
+
+    const std::lock_guard<std::mutex> lock (frame_mutex);
+    return stats;
+}
+
+// -------------------------------------------------------------------------
+
+string ThreadedCaptureManager::printStats () {
+    /**
+     * Convert the frame counters to a printable string
+    */
+
+    CaptureStats s = getStats();
+    ostringstream oss;
+    oss << "grabbed: " << s.grabbed << ", delivered: " << s.delivered << ", dropped: " << s.dropped
+        << ", unpooled: " << s.unpooled;
+    return oss.str();
+}
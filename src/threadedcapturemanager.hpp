@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+#include "cameracapturemanager.hpp"
+#include "framepool.hpp"
+
+/**
+ * Frame counters kept by the threaded capture manager. Dropped frames are frames
+ * which were grabbed but replaced by a newer one before the consumer asked for them.
+ * Unpooled frames are frames the decoder wrote to its own buffer instead of the pool buffer.
+*/
+struct CaptureStats {
+    uint64_t grabbed = 0;
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    uint64_t unpooled = 0;
+};
+
+/**
+ * Camera capture manager which grabs frames on a background thread and keeps only 
+ * the newest decoded frame. read() hands that frame to the consumer, so a slow 
+ * consumer never works through a backlog of stale frames in the driver queue.
+*/
+class ThreadedCaptureManager: public CameraCaptureManager {
+    public:
+        ThreadedCaptureManager (void);
+        ~ThreadedCaptureManager (void);
+        int open (int, int = cv::CAP_DSHOW);
+        bool read (cv::OutputArray&);
+        bool read (cv::OutputArray&, FrameMetadata&);
+        void close (void);
+        void setReadTimeout (double);
+        void setFramePool (FramePool *);
+        properties getProperties ();
+        cv::Mat getEncoded ();
+        CaptureStats getStats ();
+        string printStats ();
+
+    protected:
+        void grabLoop (std::stop_token);
+        
+        std::jthread grab_thread;
+        std::mutex frame_mutex;
+        std::condition_variable frame_cond;
+        cv::Mat latest_frame;
+        FrameMetadata latest_metadata;
+        cv::Mat latest_encoded;
+        cv::Mat delivered_encoded;
+        bool frame_ready;
+        bool running;
+        std::chrono::milliseconds read_timeout;
+        std::atomic<FramePool*> frame_pool;
+        properties opened_properties;
+        CaptureStats stats;
+};
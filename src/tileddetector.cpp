@@ -0,0 +1,182 @@
+#include "tileddetector.hpp"
+
+
+std::vector<cv::Rect> TileLayout::tiles (cv::Size frameSize) {
+    /**
+     * Tile the frame, left to right then top to bottom
+     * @param frameSize - size of the frame
+     * @returns tiles of equal size covering the frame
+    */
+
+    auto span = [this] (int length, int count, int &tileLength) {
+        tileLength = cvCeil(length / (count - (count - 1) * overlap));
+        tileLength = std::min(tileLength, length);
+        std::vector<int> starts;
+        for (int i=0; i<count; i++) {
+            starts.push_back(count > 1 ? (length - tileLength) * i / (count - 1) : 0);
+        }
+        return starts;
+    };
+
+    int width, height;
+    std::vector<int> xs = span(frameSize.width, std::max(cols, 1), width);
+    std::vector<int> ys = span(frameSize.height, std::max(rows, 1), height);
+    std::vector<cv::Rect> result;
+    for (int y : ys) {
+        for (int x : xs) {
+            result.push_back(cv::Rect(x, y, width, height));
+        }
+    }
+    return result;
+}
+
+// ======================================================================================
+
+TiledDetector::TiledDetector (std::vector<Detector *> tileWorkers, TileLayout tileLayout, float mergeThreshold) {
+    /**
+     * @param tileWorkers - detectors to run the tiles on, one thread each
+     * @param tileLayout - how to tile each frame
+     * @param mergeThreshold - overlap of the smaller box above which two boxes of a class
+     *        are the same object
+    */
+
+    CV_Assert(!tileWorkers.empty());
+    workers = tileWorkers;
+    layout = tileLayout;
+    merge_threshold = mergeThreshold;
+}
+
+// --------------------------------------------------------------------------------------
+
+void TiledDetector::detect (const cv::Mat &frame, Detections &detections) {
+    /**
+     * Detect on every tile, then merge the boxes across tiles
+     * @param frame - frame to detect on
+     * @param detections - boxes in frame coordinates
+    */
+
+    if (frame.size() != tiles_size) {
+        tiles = layout.tiles(frame.size());
+        tiles_size = frame.size();
+    }
+    tile_detections.resize(tiles.size());
+
+    // Worker w takes tiles w, w + workers, ... The first runs on this thread.
+    utils::Timer timer;
+    auto runWorker = [&] (size_t w) {
+        for (size_t t=w; t<tiles.size(); t+=workers.size()) {
+            workers[w]->detect(frame(tiles[t]), tile_detections[t]);
+        }
+    };
+    std::vector<std::future<void>> running;
+    for (size_t w=1; w<workers.size() && w<tiles.size(); w++) {
+        running.push_back(std::async(std::launch::async, runWorker, w));
+    }
+    runWorker(0);
+    for (auto &worker : running) {
+        worker.get();
+    }
+    tiles_ms.add(timer.seconds() * 1000);
+
+    timer.start();
+    raw.clear();
+    for (size_t t=0; t<tiles.size(); t++) {
+        Detections &found = tile_detections[t];
+        for (size_t i=0; i<found.size(); i++) {
+            raw.add(found.class_ids[i], found.confidences[i], found.boxes[i] + tiles[t].tl());
+        }
+    }
+    merge(raw, detections);
+    merge_ms.add(timer.seconds() * 1000);
+
+    stats.frames++;
+    stats.tiles += tiles.size();
+    stats.raw_boxes += raw.size();
+    stats.merged_boxes += detections.size();
+}
+
+// --------------------------------------------------------------------------------------
+
+void TiledDetector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Tiles come from the full frame, since each worker resizes its own tile
+    */
+
+    detect(products.frame(), detections);
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size TiledDetector::getInputSize () {
+
+    return workers[0]->getInputSize();
+}
+
+// --------------------------------------------------------------------------------------
+
+void TiledDetector::setLayout (TileLayout tileLayout) {
+
+    layout = tileLayout;
+    tiles_size = cv::Size();
+}
+
+// --------------------------------------------------------------------------------------
+
+TileLayout TiledDetector::getLayout () {
+
+    return layout;
+}
+
+// --------------------------------------------------------------------------------------
+
+TiledStats TiledDetector::getStats () {
+
+    TiledStats s = stats;
+    s.mean_tiles_ms = tiles_ms.mean();
+    s.mean_merge_ms = merge_ms.mean();
+    return s;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string TiledDetector::printStats () {
+
+    TiledStats s = getStats();
+    std::ostringstream oss;
+    oss << layout.cols << "x" << layout.rows << " tiles on " << workers.size() << " workers, "
+        << s.frames << " frames, " << s.raw_boxes << " boxes merged to " << s.merged_boxes
+        << ", tiles: " << s.mean_tiles_ms << "ms, merge: " << s.mean_merge_ms << "ms";
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+void TiledDetector::merge (Detections &found, Detections &merged) {
+    /**
+     * Greedy suppression across tiles, most confident first. Overlap is measured
+     * against the smaller box rather than the union, since a target cut by a tile
+     * edge leaves a partial box lying inside the whole one.
+     * @param found - boxes from every tile, in frame coordinates
+     * @param merged - the boxes kept
+    */
+
+    std::vector<int> order (found.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&] (int a, int b) { return found.confidences[a] > found.confidences[b]; });
+
+    merged.clear();
+    for (int i : order) {
+        const cv::Rect &box = found.boxes[i];
+        bool duplicate = false;
+        for (size_t k=0; k<merged.size() && !duplicate; k++) {
+            if (merged.class_ids[k] != found.class_ids[i]) {
+                continue;
+            }
+            int smaller = std::min(box.area(), merged.boxes[k].area());
+            duplicate = smaller > 0 && (box & merged.boxes[k]).area() > merge_threshold * smaller;
+        }
+        if (!duplicate) {
+            merged.add(found.class_ids[i], found.confidences[i], box);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "detector.hpp"
+#include "framemetadata.hpp"
+#include "utils.hpp"
+
+/**
+ * Grid of overlapping tiles. Overlap is the fraction of a tile shared with its neighbour,
+ * which should be at least the size of the largest target relative to the tile so
+ * every target lies whole within some tile.
+*/
+struct TileLayout {
+    int cols = 2;
+    int rows = 2;
+    float overlap = 0.2f;
+
+    std::vector<cv::Rect> tiles (cv::Size);
+};
+
+struct TiledStats {
+    uint64_t frames = 0;
+    uint64_t tiles = 0;
+    uint64_t raw_boxes = 0;
+    uint64_t merged_boxes = 0;
+    double mean_tiles_ms = 0.0;
+    double mean_merge_ms = 0.0;
+};
+
+/**
+ * Detects on overlapping tiles of the frame rather than the whole frame squashed to
+ * the detector input, so small targets keep their pixels. Tiles are shared out
+ * between the workers, each used by one thread at a time, and the results merged
+ * across tiles. Giving it several workers built on their own networks runs the tiles
+ * in parallel; giving it the same BatchedDetector several times runs them as one batch.
+ * The merge keeps the best of any boxes of a class that overlap by more than the
+ * merge threshold of the smaller one, which also removes the part of a target cut
+ * off at a tile edge.
+*/
+class TiledDetector: public Detector {
+    public:
+        TiledDetector (std::vector<Detector *>, TileLayout = TileLayout(), float = 0.6);
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        cv::Size getInputSize ();
+        void setLayout (TileLayout);
+        TileLayout getLayout ();
+        TiledStats getStats ();
+        std::string printStats ();
+
+    protected:
+        void merge (Detections &, Detections &);
+
+        std::vector<Detector *> workers;
+        TileLayout layout;
+        float merge_threshold;
+        std::vector<cv::Rect> tiles;
+        cv::Size tiles_size;
+        std::vector<Detections> tile_detections;
+        Detections raw;
+        TiledStats stats;
+        RollingStat tiles_ms;
+        RollingStat merge_ms;
+};
@@ -0,0 +1,134 @@
+#include "trackingdetector.hpp"
+
+
+TrackingDetector::TrackingDetector (Detector &fullDetector, int targetClass, DetectionCadence detectionCadence)
+    : detector(fullDetector), cadence(detectionCadence) {
+
+    /**
+     * @param fullDetector - detector run on detection frames
+     * @param targetClass - class followed between detections
+     * @param detectionCadence - policy for when to detect
+    */
+
+    target_class = targetClass;
+    last_tracked = false;
+}
+
+// --------------------------------------------------------------------------------------
+
+void TrackingDetector::detect (const cv::Mat &frame, Detections &detections) {
+
+    if (frame.channels() == 1) {
+        gray = frame;
+    }
+    else {
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    }
+    step(gray, detections, [&] (Detections &found) { detector.detect(frame, found); });
+}
+
+// --------------------------------------------------------------------------------------
+
+void TrackingDetector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Track on the shared grayscale frame, detect with the wrapped detector's products path
+    */
+
+    step(products.gray(), detections, [&] (Detections &found) { detector.detect(products, found); });
+}
+
+// --------------------------------------------------------------------------------------
+
+cv::Size TrackingDetector::getInputSize () {
+
+    return detector.getInputSize();
+}
+
+// --------------------------------------------------------------------------------------
+
+void TrackingDetector::follow (FrameProducts &products, cv::Rect box) {
+    /**
+     * Restart the tracker on a target chosen elsewhere, e.g. a multi object tracker's
+     * locked track, when it isn't the box the last detection started it on
+     * @param products - the frame the box was found in
+     * @param box - target box in frame coordinates
+    */
+
+    cv::Rect current = tracker.getBox();
+    if (tracker.isTracking() && current.contains(box.tl() + cv::Point(box.width / 2, box.height / 2))) {
+        return;
+    }
+    tracker.init(products.gray(), box);
+}
+
+// --------------------------------------------------------------------------------------
+
+bool TrackingDetector::wasTracked () {
+    /**
+     * @returns true if the last result came from the tracker rather than the detector
+    */
+
+    return last_tracked;
+}
+
+// --------------------------------------------------------------------------------------
+
+FlowTracker& TrackingDetector::getTracker () {
+
+    return tracker;
+}
+
+// --------------------------------------------------------------------------------------
+
+TrackingStats TrackingDetector::getStats () {
+
+    TrackingStats s = stats;
+    s.interval = cadence.getInterval();
+    return s;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::string TrackingDetector::printStats () {
+
+    TrackingStats s = getStats();
+    std::ostringstream oss;
+    oss << "detections: " << s.detections << ", tracked: " << s.tracked << ", lost: " << s.lost
+        << ", interval: " << s.interval;
+    return oss.str();
+}
+
+// --------------------------------------------------------------------------------------
+
+void TrackingDetector::step (const cv::Mat &frameGray, Detections &detections, const std::function<void (Detections &)> &runDetector) {
+    /**
+     * Track if the cadence allows it, otherwise detect and restart the tracker on the target
+    */
+
+    if (tracker.isTracking() && !cadence.detectNow()) {
+        cv::Rect box;
+        bool ok = tracker.update(frameGray, box);
+        cadence.tracked(ok, tracker.getConfidence());
+        if (ok) {
+            detections.clear();
+            detections.add(target_class, tracker.getConfidence(), box);
+            stats.tracked++;
+            last_tracked = true;
+            return;
+        }
+        stats.lost++;
+    }
+
+    runDetector(detections);
+    stats.detections++;
+    last_tracked = false;
+
+    int target = detections.find(target_class);
+    if (target >= 0) {
+        tracker.init(frameGray, detections.boxes[target]);
+    }
+    else {
+        tracker.reset();
+    }
+    cadence.detected(target >= 0);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+#include "detector.hpp"
+#include "flowtracker.hpp"
+
+struct TrackingStats {
+    uint64_t detections = 0;
+    uint64_t tracked = 0;
+    uint64_t lost = 0;
+    int interval = 1;
+};
+
+/**
+ * Runs the full detector only every few frames and follows the target with a
+ * FlowTracker in between. The cadence adapts to the tracker's health, so a steady
+ * target costs a detection every maxInterval frames and a hard one every frame.
+ * Tracked frames report the target box alone, with the tracker confidence as its
+ * confidence.
+*/
+class TrackingDetector: public Detector {
+    public:
+        TrackingDetector (Detector &, int, DetectionCadence = DetectionCadence());
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        cv::Size getInputSize ();
+        void follow (FrameProducts &, cv::Rect);
+        bool wasTracked ();
+        FlowTracker& getTracker ();
+        TrackingStats getStats ();
+        std::string printStats ();
+
+    protected:
+        void step (const cv::Mat &, Detections &, const std::function<void (Detections &)> &);
+
+        Detector &detector;
+        int target_class;
+        DetectionCadence cadence;
+        FlowTracker tracker;
+        cv::Mat gray;
+        bool last_tracked;
+        TrackingStats stats;
+};
@@ -0,0 +1,252 @@
+#include "yolodecoder.hpp"
+
+
+YoloDecoder::YoloDecoder (float confidenceThreshold, float nmsThreshold) {
+    /**
+     * @param confidenceThreshold - minimum class score to keep a box
+     * @param nmsThreshold - IOU above which overlapping boxes of a class are suppressed, 0 to keep them all
+    */
+
+    setThresholds(confidenceThreshold, nmsThreshold);
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDecoder::decode (const std::vector<cv::Mat> &outs, cv::Size frameSize, Detections &detections, size_t image, size_t batch) {
+    /**
+     * Decode the boxes of one image of a forward pass
+     * @param outs - the outputs of every unconnected layer
+     * @param frameSize - size of the image the boxes are scaled to
+     * @param detections - receives the boxes in frameSize coordinates. Its buffers are
+     *                     reused, so keep passing the same one to avoid allocating.
+     * @param image - index of the image within the batch
+     * @param batch - number of images in the batch
+    */
+
+    Detections &found = nms_threshold > 0 ? candidates : detections;
+    found.clear();
+
+    for (const auto &out : outs) {
+        // With more than one image the region layer's output is [images, boxes, 5 + classes], 
+        // otherwise it's 2-D with a row per box
+        int rows, row_width;
+        const float* data;
+        if (out.dims == 3) {
+            CV_Assert(out.size[0] == (int)batch && out.isContinuous());
+            rows = out.size[1];
+            row_width = out.size[2];
+            data = out.ptr<float>((int)image);
+        }
+        else {
+            CV_Assert(out.rows % batch == 0 && out.isContinuous());
+            rows = out.rows / (int)batch;
+            row_width = out.cols;
+            data = out.ptr<float>(rows * (int)image);
+        }
+        int class_count = row_width - 5;
+
+        for (int i=0; i<rows; i++) {
+            const float* row = data + (size_t)i * row_width;
+
+            // The region layer has already scaled the class scores by objectness
+            if (row[4] < confidence_threshold) {
+                continue;
+            }
+
+            float best_score;
+            int best_class = bestClass(row + 5, class_count, best_score);
+            if (best_class < 0 || best_score < confidence_threshold) {
+                continue;
+            }
+
+            int width = (int)(row[2] * frameSize.width);
+            int height = (int)(row[3] * frameSize.height);
+            int left = (int)(row[0] * frameSize.width) - width / 2;
+            int top = (int)(row[1] * frameSize.height) - height / 2;
+            found.add(best_class, best_score, cv::Rect(left, top, width, height));
+        }
+    }
+
+    if (nms_threshold > 0) {
+        suppress(detections);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDecoder::setThresholds (float confidenceThreshold, float nmsThreshold) {
+
+    confidence_threshold = confidenceThreshold;
+    nms_threshold = nmsThreshold;
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDecoder::setClasses (std::vector<int> classIds) {
+    /**
+     * @param classIds - the only classes decoded, empty for all of them
+     * @throws if a class id is negative. Ids past the model's classes are skipped when decoding.
+    */
+
+    for (int c : classIds) {
+        if (c < 0) {
+            throw std::runtime_error("Negative class id: " + std::to_string(c));
+        }
+    }
+    classes = classIds;
+}
+
+// --------------------------------------------------------------------------------------
+
+std::vector<int> YoloDecoder::getClasses () {
+
+    return classes;
+}
+
+// --------------------------------------------------------------------------------------
+
+int YoloDecoder::bestClass (const float* scores, int classCount, float &bestScore) {
+    /**
+     * Highest scoring class of one row
+     * @param scores - the row's class scores
+     * @param classCount - number of class scores
+     * @param bestScore - receives the score of the returned class
+     * @returns the class, or -1 if none of the configured classes are in the output
+    */
+
+    int best = -1;
+    bestScore = 0.0f;
+
+    if (!classes.empty()) {
+        for (int c : classes) {
+            if (c < classCount && (best < 0 || scores[c] > bestScore)) {
+                best = c;
+                bestScore = scores[c];
+            }
+        }
+        return best;
+    }
+
+    // Find the top score a vector at a time. It only needs its index when it will be kept.
+    int c = 0;
+    float top = scores[0];
+#if CV_SIMD
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    if (classCount >= lanes) {
+        cv::v_float32 top_vector = cv::vx_load(scores);
+        for (c=lanes; c<=classCount - lanes; c+=lanes) {
+            top_vector = cv::v_max(top_vector, cv::vx_load(scores + c));
+        }
+        top = cv::v_reduce_max(top_vector);
+    }
+#endif
+    for (; c<classCount; c++) {
+        top = std::max(top, scores[c]);
+    }
+
+    bestScore = top;
+    if (top < confidence_threshold) {
+        return 0;
+    }
+    for (c=0; c<classCount; c++) {
+        if (scores[c] == top) {
+            return c;
+        }
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDecoder::suppress (Detections &detections) {
+    /**
+     * Non maximum suppression of the candidates within each class
+    */
+
+    cv::dnn::NMSBoxesBatched(candidates.boxes, candidates.confidences, candidates.class_ids,
+        confidence_threshold, nms_threshold, keep);
+
+    detections.clear();
+    for (int i : keep) {
+        detections.add(candidates.class_ids[i], candidates.confidences[i], candidates.boxes[i]);
+    }
+}
+
+// ======================================================================================
+
+YoloDetector::YoloDetector (std::string config, std::string weights, cv::Size inputSize, int backend, int target)
+    : DnnDetector(config, weights, inputSize, backend, target) {
+
+    /**
+     * Load a Darknet YOLO model
+     * @param config - .cfg file
+     * @param weights - .weights file
+     * @param inputSize - network input size
+     * @param backend - cv::dnn backend
+     * @param target - cv::dnn target
+    */
+
+    decoder.setThresholds(confidence_threshold, nms_threshold);
+    out_names = net.getUnconnectedOutLayersNames();
+}
+
+// --------------------------------------------------------------------------------------
+
+YoloDetector::YoloDetector (cv::dnn::Net network, cv::Size inputSize)
+    : DnnDetector(network, inputSize) {
+
+    decoder.setThresholds(confidence_threshold, nms_threshold);
+    out_names = net.getUnconnectedOutLayersNames();
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDetector::detect (const cv::Mat &frame, Detections &detections) {
+
+    // Same input parameters DnnDetector gives DetectionModel
+    if (BlobKernel::supports(frame)) {
+        blob_kernel.run(frame, blob, input_size, 1.0/255, false);
+    }
+    else {
+        cv::dnn::blobFromImage(frame, blob, 1.0/255, input_size, cv::Scalar(), false, false);
+    }
+    forward(blob, frame.size(), detections);
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDetector::detect (FrameProducts &products, Detections &detections) {
+    /**
+     * Run on the shared input blob. The boxes are normalized, so they decode straight 
+     * to frame coordinates.
+    */
+
+    forward(products.blob(input_size), products.frame().size(), detections);
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDetector::setThresholds (float confidenceThreshold, float nmsThreshold) {
+
+    DnnDetector::setThresholds(confidenceThreshold, nmsThreshold);
+    decoder.setThresholds(confidenceThreshold, nmsThreshold);
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDetector::setClasses (std::vector<int> classIds) {
+    /**
+     * @param classIds - the only classes reported, empty for all of them
+    */
+
+    decoder.setClasses(classIds);
+}
+
+// --------------------------------------------------------------------------------------
+
+void YoloDetector::forward (const cv::Mat &input, cv::Size frameSize, Detections &detections) {
+
+    net.setInput(input);
+    net.forward(outs, out_names);
+    decoder.decode(outs, frameSize, detections);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include "blobkernel.hpp"
+#include "detector.hpp"
+
+/**
+ * Turns the raw output of a Darknet YOLO network into detections, the same way
+ * cv::dnn::DetectionModel does, but for any one image of a batched forward pass.
+ * Each region layer output has one row per candidate box,
+ * [center x, center y, width, height, objectness, class scores...], normalized to the
+ * input, with the rows of every image in the batch stacked one after the other.
+ *
+ * Given a class set, only those classes are scored, boxed and suppressed, which is
+ * nearly all of the post-processing skipped when only one target matters. Rows are
+ * rejected on objectness first since no class can score above it.
+*/
+class YoloDecoder {
+    public:
+        YoloDecoder (float = 0.5, float = 0.0);
+        void decode (const std::vector<cv::Mat> &, cv::Size, Detections &, size_t = 0, size_t = 1);
+        void setThresholds (float, float);
+        void setClasses (std::vector<int>);
+        std::vector<int> getClasses ();
+
+    protected:
+        int bestClass (const float*, int, float &);
+        void suppress (Detections &);
+
+        float confidence_threshold;
+        float nms_threshold;
+        std::vector<int> classes;
+        Detections candidates;
+        std::vector<int> keep;
+};
+
+/**
+ * DnnDetector which runs the network itself and decodes the raw output with a
+ * YoloDecoder, so a class set filters the output before any boxes are built.
+ * The input blob comes from the frame's shared products when there are some.
+*/
+class YoloDetector: public DnnDetector {
+    public:
+        YoloDetector (std::string, std::string, cv::Size = cv::Size(320, 320), 
+            int = cv::dnn::DNN_BACKEND_OPENCV, int = cv::dnn::DNN_TARGET_CPU);
+        YoloDetector (cv::dnn::Net, cv::Size = cv::Size(320, 320));
+        void detect (const cv::Mat &, Detections &);
+        void detect (FrameProducts &, Detections &);
+        void setThresholds (float, float);
+        void setClasses (std::vector<int>);
+
+    protected:
+        void forward (const cv::Mat &, cv::Size, Detections &);
+
+        YoloDecoder decoder;
+        std::vector<std::string> out_names;
+        std::vector<cv::Mat> outs;
+        cv::Mat blob;
+        BlobKernel blob_kernel;
+};